@@ -0,0 +1,27 @@
+# assembles good, bad, good, bad inputs at once with HSAILASM; fails unless
+# the run fails, both bad inputs are reported in input order and both good
+# inputs, including the one after the first bad input, are assembled
+configure_file(${GOOD} many-good1.hsail COPYONLY)
+configure_file(${GOOD} many-good2.hsail COPYONLY)
+file(WRITE many-bad1.hsail "bad input 1;\n")
+file(WRITE many-bad2.hsail "bad input 2;\n")
+file(REMOVE many-good1.brig many-good2.brig)
+
+execute_process(COMMAND ${HSAILASM} -assemble -jobs 2
+                        many-good1.hsail many-bad1.hsail many-good2.hsail many-bad2.hsail
+                RESULT_VARIABLE result
+                OUTPUT_VARIABLE output
+                ERROR_VARIABLE output)
+if(result EQUAL 0)
+  message(FATAL_ERROR "assembling a bad input succeeded:\n${output}")
+endif()
+string(FIND "${output}" "many-bad1.hsail:" bad1)
+string(FIND "${output}" "many-bad2.hsail:" bad2)
+if(bad1 EQUAL -1 OR bad2 EQUAL -1 OR NOT bad1 LESS bad2)
+  message(FATAL_ERROR "bad inputs are not reported in input order:\n${output}")
+endif()
+foreach(good many-good1.brig many-good2.brig)
+  if(NOT EXISTS ${good})
+    message(FATAL_ERROR "${good} was not written:\n${output}")
+  endif()
+endforeach()
@@ -0,0 +1,32 @@
+# assembles INPUT read by HSAILASM from standard input, both redirected from
+# the file and through a pipe; fails unless the results equal EXPECTED
+execute_process(COMMAND ${HSAILASM} -assemble - -o stdin-file.brig
+                INPUT_FILE ${INPUT}
+                RESULT_VARIABLE result
+                OUTPUT_VARIABLE output
+                ERROR_VARIABLE output)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "assembling from standard input failed:\n${output}")
+endif()
+set(outputs stdin-file.brig)
+
+if(UNIX)
+  # a pipe cannot seek, so the scanner reads it incrementally
+  execute_process(COMMAND cat ${INPUT}
+                  COMMAND ${HSAILASM} -assemble - -o stdin-pipe.brig
+                  RESULT_VARIABLE result
+                  OUTPUT_VARIABLE output
+                  ERROR_VARIABLE output)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "assembling from a pipe failed:\n${output}")
+  endif()
+  list(APPEND outputs stdin-pipe.brig)
+endif()
+
+foreach(brig ${outputs})
+  execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${EXPECTED} ${brig}
+                  RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${brig} differs from ${EXPECTED}")
+  endif()
+endforeach()
@@ -0,0 +1,8 @@
+# fails unless file SMALLER is smaller than file LARGER
+file(READ ${SMALLER} smaller HEX)
+file(READ ${LARGER} larger HEX)
+string(LENGTH "${smaller}" smallerSize)
+string(LENGTH "${larger}" largerSize)
+if(NOT smallerSize LESS largerSize)
+  message(FATAL_ERROR "${SMALLER} is not smaller than ${LARGER}")
+endif()
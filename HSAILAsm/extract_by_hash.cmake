@@ -0,0 +1,15 @@
+# extracts module MODULE of archive ARCHIVE to OUTPUT by the content hash
+# -list prints for it
+execute_process(COMMAND ${HSAILASM} -list ${ARCHIVE}
+                OUTPUT_VARIABLE listing RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "cannot list ${ARCHIVE}")
+endif()
+if(NOT listing MATCHES "([0-9a-f]+) [0-9]+ ${MODULE}\n")
+  message(FATAL_ERROR "${MODULE} is not listed in ${ARCHIVE}:\n${listing}")
+endif()
+execute_process(COMMAND ${HSAILASM} -extract -by-hash ${ARCHIVE} ${CMAKE_MATCH_1} -o ${OUTPUT}
+                RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+  message(FATAL_ERROR "cannot extract ${MODULE} by hash ${CMAKE_MATCH_1}")
+endif()
@@ -683,16 +683,20 @@ BrigDwarfGenerator_impl::generateDwarfForBrigSymbol( HSAIL_ASM::Directive d,
 
     // declared file, line, column numbers
     //
-    const HSAIL_ASM::SourceInfo *pSrcInfo( dSym.container()->sourceInfo( dSym ) );
+    const HSAIL_ASM::SourceInfo srcInfo( dSym.container()->sourceInfo( dSym ) );
 
     // TBD handle .loc changing the current src file
     //
     dwarf_add_AT_unsigned_const( m_pDwarfDebug, pVariableEntry, DW_AT_decl_file,
                                  m_srcFileLineTableIndex, nullError );
-    dwarf_add_AT_unsigned_const( m_pDwarfDebug, pVariableEntry, DW_AT_decl_line,
-                                 pSrcInfo->line + 1, nullError );
-    dwarf_add_AT_unsigned_const( m_pDwarfDebug, pVariableEntry, DW_AT_decl_column,
-                                 pSrcInfo->column + 1, nullError );
+    // items created without source info, e.g. through Brigantine, have no position
+    if ( srcInfo.line != -1 )
+    {
+        dwarf_add_AT_unsigned_const( m_pDwarfDebug, pVariableEntry, DW_AT_decl_line,
+                                     srcInfo.line + 1, nullError );
+        dwarf_add_AT_unsigned_const( m_pDwarfDebug, pVariableEntry, DW_AT_decl_column,
+                                     srcInfo.column + 1, nullError );
+    }
 
     return pVariableEntry;
 }
@@ -728,9 +732,10 @@ void BrigDwarfGenerator_impl::generateDwarfForBrigKernelFunction( HSAIL_ASM::Dir
 
     subrName = HSAIL_ASM::SRef(d.name());
     firstCodeElementInSubprogram = d.firstCodeBlockEntry();
-    const HSAIL_ASM::SourceInfo *pSrcInfo( d.container()->sourceInfo( d ) );
-    declLine = pSrcInfo->line + 1;
-    declColumn = pSrcInfo->column + 1;
+    const HSAIL_ASM::SourceInfo declSrcInfo( d.container()->sourceInfo( d ) );
+    bool const hasDeclPos = declSrcInfo.line != -1;
+    declLine = declSrcInfo.line + 1;
+    declColumn = declSrcInfo.column + 1;
     firstInArg = d.firstInArg();
     numInParams = d.inArgCount();
     if ( d.kind() == BRIG_KIND_DIRECTIVE_FUNCTION ) {
@@ -762,8 +767,8 @@ void BrigDwarfGenerator_impl::generateDwarfForBrigKernelFunction( HSAIL_ASM::Dir
           startPC = instr.brigOffset();
         }
         lastInstr = instr;
-        const HSAIL_ASM::SourceInfo *pSrcInfo( instr.container()->sourceInfo( instr ) );
-        if (!pSrcInfo) continue;
+        const HSAIL_ASM::SourceInfo srcInfo( instr.container()->sourceInfo( instr ) );
+        if (srcInfo.line == -1) continue;
         if ( !m_isDwarfLineSetAddressCalled )
         {
             dwarf_lne_set_address( m_pDwarfDebug,
@@ -775,7 +780,7 @@ void BrigDwarfGenerator_impl::generateDwarfForBrigKernelFunction( HSAIL_ASM::Dir
         dwarf_add_line_entry( m_pDwarfDebug,
                               m_srcFileLineTableIndex,
                               instr.brigOffset(),                // address
-                              pSrcInfo->line + 1, pSrcInfo->column + 1,
+                              srcInfo.line + 1, srcInfo.column + 1,
                               true,                              // is src statement
                               false,                             // is basic block begin
                               nullError );
@@ -806,10 +811,13 @@ void BrigDwarfGenerator_impl::generateDwarfForBrigKernelFunction( HSAIL_ASM::Dir
     //
     dwarf_add_AT_unsigned_const( m_pDwarfDebug, pSubprogramEntry, DW_AT_decl_file,
                                  m_srcFileLineTableIndex, nullError );
-    dwarf_add_AT_unsigned_const( m_pDwarfDebug, pSubprogramEntry, DW_AT_decl_line,
-                                 declLine, nullError );
-    dwarf_add_AT_unsigned_const( m_pDwarfDebug, pSubprogramEntry, DW_AT_decl_column,
-                                 declColumn, nullError );
+    if ( hasDeclPos )
+    {
+        dwarf_add_AT_unsigned_const( m_pDwarfDebug, pSubprogramEntry, DW_AT_decl_line,
+                                     declLine, nullError );
+        dwarf_add_AT_unsigned_const( m_pDwarfDebug, pSubprogramEntry, DW_AT_decl_column,
+                                     declColumn, nullError );
+    }
 
     // is kernel? attribute
     //
@@ -46,19 +46,430 @@
 #include "HSAILBrigObjectFile.h"
 
 #include <algorithm>
+#include <cstring>
+#include <new>
 #include <ostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 
 namespace HSAIL_ASM {
 
+// SECTION BUFFER
+
+#if !defined(_WIN32) && defined(MAP_ANONYMOUS)
+// address space is scarce on 32-bit hosts
+static const bool canReserveAddressSpace = sizeof(void*) >= 8;
+
+static char* reserveAddressSpace(size_t numBytes) {
+    void* const p = mmap(NULL, numBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return p != MAP_FAILED ? static_cast<char*>(p) : NULL;
+}
+
+static bool commitAddressSpace(char* p, size_t numBytes) {
+    return mprotect(p, numBytes, PROT_READ | PROT_WRITE) == 0;
+}
+
+static void releaseAddressSpace(char* p, size_t numBytes) {
+    munmap(p, numBytes);
+}
+#else
+static const bool canReserveAddressSpace = false;
+
+static char* reserveAddressSpace(size_t)         { return NULL; }
+static bool commitAddressSpace(char*, size_t)   { return false; }
+static void releaseAddressSpace(char*, size_t)  {}
+#endif
+
+enum {
+    // smaller buffers live on the heap to save on mappings
+    SECTION_BUFFER_MIN_MAPPED_SIZE = 1 << 20,
+    SECTION_BUFFER_MIN_RESERVATION = 64 << 20,
+    SECTION_BUFFER_COMMIT_GRANULARITY = 64 << 10
+};
+
+void SectionBuffer::release() {
+    if (m_mapped) {
+        releaseAddressSpace(m_data, m_reserved);
+    } else {
+        std::vector<char>().swap(m_heap);
+    }
+    m_data = NULL;
+    m_size = m_committed = m_reserved = 0;
+    m_mapped = false;
+}
+
+// point the buffer at the storage of m_heap
+void SectionBuffer::adoptHeap() {
+    m_data = m_heap.data();
+    m_size = m_heap.size();
+    m_committed = m_reserved = m_heap.capacity();
+    m_mapped = false;
+}
+
+// move the data to new storage for numBytes. Unless storage is HEAP_STORAGE,
+// large buffers go to a reservation of address space. Where that fails, the
+// heap is used unless storage is MAPPED_STORAGE, in which case the buffer
+// is left as is.
+void SectionBuffer::relocate(size_t numBytes, Storage storage) {
+    char*  data = NULL;
+    size_t reserved = 0;
+    size_t committed = 0;
+    if (canReserveAddressSpace && storage != HEAP_STORAGE &&
+        numBytes >= SECTION_BUFFER_MIN_MAPPED_SIZE) {
+        reserved = align((std::max)(numBytes, (size_t)SECTION_BUFFER_MIN_RESERVATION),
+                         SECTION_BUFFER_COMMIT_GRANULARITY);
+        committed = align(m_size, SECTION_BUFFER_COMMIT_GRANULARITY);
+        data = reserveAddressSpace(reserved);
+        if (data && committed > 0 && !commitAddressSpace(data, committed)) {
+            releaseAddressSpace(data, reserved);
+            data = NULL;
+        }
+    }
+    if (data) {
+        size_t const size = m_size;
+        if (size > 0) {
+            memcpy(data, m_data, size);
+        }
+        release();
+        m_data = data;
+        m_size = size;
+        m_committed = committed;
+        m_reserved = reserved;
+        m_mapped = true;
+        return;
+    }
+    if (storage == MAPPED_STORAGE) {
+        return;
+    }
+    std::vector<char> heap;
+    heap.reserve(numBytes);
+    heap.assign(m_data, m_data + m_size);
+    release();
+    m_heap.swap(heap);
+    adoptHeap();
+}
+
+void SectionBuffer::ensureCapacity(size_t numBytes) {
+    if (numBytes <= m_committed) return;
+    if (numBytes > m_reserved) {
+        relocate((std::max)(numBytes, 2 * m_reserved));
+    }
+    if (numBytes > m_committed) {
+        assert(m_mapped);
+        size_t const committed = (std::min)(align(numBytes, SECTION_BUFFER_COMMIT_GRANULARITY), m_reserved);
+        if (commitAddressSpace(m_data + m_committed, committed - m_committed)) {
+            m_committed = committed;
+        } else {
+            // the system refused to back the reservation (e.g. strict
+            // overcommit accounting), the heap may still do
+            relocate((std::max)(numBytes, 2 * m_size), HEAP_STORAGE);
+        }
+    }
+}
+
+// set the size of data within committed storage
+void SectionBuffer::setSize(size_t numBytes) {
+    assert(numBytes <= m_committed);
+    if (!m_mapped) {
+        // no reallocation within capacity, so m_data stays valid
+        m_heap.resize(numBytes);
+    }
+    m_size = numBytes;
+}
+
+void SectionBuffer::reserve(size_t numBytes) {
+    if (numBytes > m_reserved) {
+        relocate(numBytes);
+    }
+}
+
+void SectionBuffer::reserveUncommitted(size_t numBytes) {
+    // smaller buffers stay on the heap anyway
+    if (numBytes > m_reserved && numBytes >= SECTION_BUFFER_MIN_MAPPED_SIZE) {
+        relocate(numBytes, MAPPED_STORAGE);
+    }
+}
+
+void SectionBuffer::swap(std::vector<char>& v) {
+    release();
+    m_heap.swap(v);
+    adoptHeap();
+}
+
+void SectionBuffer::resize(size_t numBytes, char fill) {
+    ensureCapacity(numBytes);
+    size_t const oldSize = m_size;
+    setSize(numBytes);
+    if (numBytes > oldSize) {
+        memset(m_data + oldSize, fill, numBytes - oldSize);
+    }
+}
+
+void SectionBuffer::assign(const char* start, const char* end) {
+    size_t const numBytes = end - start;
+    setSize(0);
+    ensureCapacity(numBytes);
+    setSize(numBytes);
+    memcpy(m_data, start, numBytes);
+}
+
+void SectionBuffer::insert(size_t offset, size_t numBytes, char fill) {
+    assert(offset <= m_size);
+    ensureCapacity(m_size + numBytes);
+    size_t const oldSize = m_size;
+    setSize(oldSize + numBytes);
+    memmove(m_data + offset + numBytes, m_data + offset, oldSize - offset);
+    memset(m_data + offset, fill, numBytes);
+}
+
+void SectionBuffer::insert(size_t offset, const char* start, const char* end) {
+    assert(offset <= m_size);
+    if (start >= m_data && start < m_data + m_size) {
+        // source may move while making room for it
+        std::vector<char> const tmp(start, end);
+        insert(offset, tmp.data(), tmp.data() + tmp.size());
+        return;
+    }
+    size_t const numBytes = end - start;
+    ensureCapacity(m_size + numBytes);
+    size_t const oldSize = m_size;
+    setSize(oldSize + numBytes);
+    memmove(m_data + offset + numBytes, m_data + offset, oldSize - offset);
+    memcpy(m_data + offset, start, numBytes);
+}
+
+void SectionBuffer::erase(size_t offset, size_t numBytes) {
+    assert(offset + numBytes <= m_size);
+    memmove(m_data + offset, m_data + offset + numBytes, m_size - offset - numBytes);
+    setSize(m_size - numBytes);
+}
+
+// SOURCE INFO TABLE
+
+// an entry is encoded relative to the previous one as
+//   varint(offset delta)
+//   varint(zigzag(line delta) << 1 | column changed)
+//   [varint(zigzag(column delta)) if column changed]
+// consecutive items typically take two or three bytes
+
+static void putVarint(uint64_t v, std::vector<uint8_t>& bytes) {
+    while (v >= 0x80) {
+        bytes.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    bytes.push_back((uint8_t)v);
+}
+
+static uint64_t getVarint(const uint8_t*& p) {
+    uint64_t v = 0;
+    for(unsigned shift = 0; ; shift += 7) {
+        uint8_t const b = *p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+}
+
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+void SourceInfoTable::encodeDelta(const Entry& prev, const Entry& e, Bytes& bytes) {
+    assert(prev.first < e.first);
+    putVarint(e.first - prev.first, bytes);
+    bool const columnChanged = e.second.column != prev.second.column;
+    putVarint(zigzag((int64_t)e.second.line - prev.second.line) << 1 | (columnChanged ? 1 : 0), bytes);
+    if (columnChanged) {
+        putVarint(zigzag((int64_t)e.second.column - prev.second.column), bytes);
+    }
+}
+
+void SourceInfoTable::decodeDelta(const uint8_t*& p, Entry& e) {
+    e.first += (Offset)getVarint(p);
+    uint64_t const line = getVarint(p);
+    e.second.line += (int)unzigzag(line >> 1);
+    if (line & 1) {
+        e.second.column += (int)unzigzag(getVarint(p));
+    }
+}
+
+void SourceInfoTable::encode(const Entry* begin, const Entry* end, Checkpoints& cps, Bytes& bytes) {
+    for(const Entry* e = begin; e != end; ++e) {
+        if ((e - begin) % BLOCK_SIZE == 0) {
+            Checkpoint const cp = { e->first, e->second, (uint32_t)bytes.size() };
+            cps.push_back(cp);
+        } else {
+            encodeDelta(e[-1], *e, bytes);
+        }
+    }
+}
+
+void SourceInfoTable::decodeBlock(size_t block, Entries& res) const {
+    const Checkpoint& cp = m_checkpoints[block];
+    Entry e(cp.offset, cp.si);
+    res.push_back(e);
+    const uint8_t* p = m_bytes.data() + cp.pos;
+    const uint8_t* const end = m_bytes.data() + blockEnd(block);
+    while (p < end) {
+        decodeDelta(p, e);
+        res.push_back(e);
+    }
+}
+
+static bool entryLess(Offset o, const SourceInfoTable::Entry& e) { return o < e.first; }
+
+size_t SourceInfoTable::findBlock(Offset o) const {
+    size_t lo = 0, hi = m_checkpoints.size();
+    while (hi - lo > 1) {
+        size_t const mid = lo + (hi - lo) / 2;
+        if (m_checkpoints[mid].offset <= o) lo = mid; else hi = mid;
+    }
+    return lo;
+}
+
+void SourceInfoTable::clear() {
+    Checkpoints().swap(m_checkpoints);
+    Bytes().swap(m_bytes);
+    m_count = 0;
+    m_lastBlockSize = 0;
+}
+
+void SourceInfoTable::swap(SourceInfoTable& other) {
+    m_checkpoints.swap(other.m_checkpoints);
+    m_bytes.swap(other.m_bytes);
+    std::swap(m_count, other.m_count);
+    std::swap(m_last, other.m_last);
+    std::swap(m_lastBlockSize, other.m_lastBlockSize);
+}
+
+void SourceInfoTable::add(Offset o, const SourceInfo& si) {
+    Entry const e(o, si);
+    // on write most of offsets come in ascending order
+    if (m_count == 0 || m_last.first < o) {
+        if (m_lastBlockSize == BLOCK_SIZE || m_count == 0) {
+            Checkpoint const cp = { o, si, (uint32_t)m_bytes.size() };
+            m_checkpoints.push_back(cp);
+            m_lastBlockSize = 0;
+        } else {
+            encodeDelta(m_last, e, m_bytes);
+        }
+        m_last = e;
+        ++m_lastBlockSize;
+        ++m_count;
+        return;
+    }
+
+    // re-encode the block the entry belongs to
+    size_t const block = findBlock(o);
+    Entries entries;
+    decodeBlock(block, entries);
+    Entries::iterator const p = std::upper_bound(entries.begin(), entries.end(), o, entryLess);
+    if (p != entries.begin() && (p - 1)->first == o) {
+        (p - 1)->second = si;
+    } else {
+        entries.insert(p, e);
+        ++m_count;
+    }
+
+    Checkpoints cps;
+    Bytes bytes;
+    encode(entries.data(), entries.data() + entries.size(), cps, bytes);
+    size_t const pos = m_checkpoints[block].pos, end = blockEnd(block);
+    for(Checkpoints::iterator i = cps.begin(); i != cps.end(); ++i) {
+        i->pos += (uint32_t)pos;
+    }
+    int64_t const shift = (int64_t)bytes.size() - (int64_t)(end - pos);
+    for(Checkpoints::iterator i = m_checkpoints.begin() + block + 1; i != m_checkpoints.end(); ++i) {
+        i->pos = (uint32_t)(i->pos + shift);
+    }
+    bool const isLastBlock = block + 1 == m_checkpoints.size();
+    m_bytes.erase(m_bytes.begin() + pos, m_bytes.begin() + end);
+    m_bytes.insert(m_bytes.begin() + pos, bytes.begin(), bytes.end());
+    m_checkpoints.erase(m_checkpoints.begin() + block);
+    m_checkpoints.insert(m_checkpoints.begin() + block, cps.begin(), cps.end());
+    if (isLastBlock) {
+        m_last = entries.back();
+        m_lastBlockSize = (unsigned)((entries.size() - 1) % BLOCK_SIZE + 1);
+    }
+}
+
+bool SourceInfoTable::find(Offset o, SourceInfo& res) const {
+    if (m_count == 0 || o < m_checkpoints.front().offset || m_last.first < o) return false;
+    size_t const block = findBlock(o);
+    const Checkpoint& cp = m_checkpoints[block];
+    Entry e(cp.offset, cp.si);
+    const uint8_t* p = m_bytes.data() + cp.pos;
+    const uint8_t* const end = m_bytes.data() + blockEnd(block);
+    while (e.first < o && p < end) {
+        decodeDelta(p, e);
+    }
+    if (e.first != o) return false;
+    res = e.second;
+    return true;
+}
+
+void SourceInfoTable::entries(Entries& res) const {
+    res.reserve(res.size() + m_count);
+    for(size_t block = 0; block < m_checkpoints.size(); ++block) {
+        decodeBlock(block, res);
+    }
+}
+
+void SourceInfoTable::assign(const Entries& src) {
+    clear();
+    if (src.empty()) return;
+    encode(src.data(), src.data() + src.size(), m_checkpoints, m_bytes);
+    m_count = src.size();
+    m_last = src.back();
+    m_lastBlockSize = (unsigned)((src.size() - 1) % BLOCK_SIZE + 1);
+}
+
+// BRIG CONTAINER
+
+static uint64_t getModuleHash(const BrigModuleHeader& hdr) {
+    uint64_t h = 0;
+    for (int i = 7; i >= 0; --i) h = (h << 8) | hdr.hash[i];
+    return h;
+}
+
+static void setModuleHash(BrigModuleHeader& hdr, uint64_t h) {
+    for (int i = 0; i < 8; ++i, h >>= 8) hdr.hash[i] = (uint8_t)h;
+}
+
+static void hashSection(ContentHasher& hasher, const BrigSectionImpl& s) {
+    // sections start with their byteCount, so section boundaries are
+    // unambiguous
+    hasher.update(s.getData(0), s.size());
+}
+
 BrigContainer::BrigContainer()
   : m_brigModuleHeader(0)
+  , m_brigModuleStorageBytes(0)
+  , m_recordedHash(0)
+  , m_lazyPending(0)
+  , m_lazyLoadFailed(false)
 {
     m_sections.push_back(std::unique_ptr<BrigSectionImpl>(new DataSection(this)));
     m_sections.push_back(std::unique_ptr<BrigSectionImpl>(new CodeSection(this)));
     m_sections.push_back(std::unique_ptr<BrigSectionImpl>(new OperandSection(this)));
 }
 
+void BrigContainer::reserveForSourceSize(size_t numBytes) {
+    if (isROContainer()) return;
+    // typical ratios of section sizes to HSAIL text size (operands before optimization)
+    strings().reserveUncommitted(strings().size() + numBytes / 2);
+    code().reserveUncommitted(code().size() + numBytes / 2);
+    operands().reserveUncommitted(operands().size() + numBytes);
+}
+
 int BrigContainer::addSection(std::unique_ptr<BrigSectionImpl>&& s)
 {
     assert(s->container()==nullptr);
@@ -80,8 +491,13 @@ void BrigContainer::initSections(const BrigModuleHeader& brigModule,
     }
 }
 
-BrigContainer::BrigContainer(const BrigModuleHeader* brigModule) {
+BrigContainer::BrigContainer(const BrigModuleHeader* brigModule)
+  : m_brigModuleStorageBytes(0)
+  , m_lazyPending(0)
+  , m_lazyLoadFailed(false)
+{
     m_brigModuleHeader = brigModule;
+    m_recordedHash = getModuleHash(*brigModule);
     initSections(*brigModule, m_sections);
 }
 
@@ -103,6 +519,12 @@ SRef brigSectionNameById(int id)
 int BrigContainer::brigSectionIdByName(SRef name) const
 {
   for(unsigned i=0; i < m_sections.size(); ++i) {
+    if (isLazySection(i)) {
+      // avoid loading sections just to find out their names
+      if (name == m_lazySectionNames[i])
+        return i;
+      continue;
+    }
     const BrigSectionImpl& s = sectionById(i);
     std::string sname = s.name();
     if (name == s.name())
@@ -114,12 +536,15 @@ int BrigContainer::brigSectionIdByName(SRef name) const
 
 BrigSectionImpl::BrigSectionImpl(SRef name, class BrigContainer *container)
     : m_container(container)
+    , m_copyOnWrite(false)
+    , m_annotate(true)
+    , m_batchEnd(0)
 {
     // m_buffer.reserve(1024*1024);
     unsigned headerByteCount = (unsigned)(sizeof(BrigSectionHeader) - 1 + name.length());
     headerByteCount = (headerByteCount + ITEM_ALIGNMENT - 1) & ~(ITEM_ALIGNMENT - 1);
     m_buffer.resize(headerByteCount);
-    m_data = (BrigSectionHeader*)&m_buffer[0];
+    m_data = (BrigSectionHeader*)m_buffer.data();
     secHeader()->byteCount = headerByteCount;
     secHeader()->headerByteCount = headerByteCount;
     secHeader()->nameLength = (unsigned)name.length();
@@ -186,19 +611,6 @@ int BrigContainer::loadSection(int index, BrigSectionImpl::Buffer& data, bool in
     return 0;
 }
 
-class StringRefComparer
-{
-    DataSection& m_section;
-public:
-    StringRefComparer(DataSection* section) : m_section(*section) {}
-    bool operator()(Offset testStrOfs,const SRef& key) {
-        return m_section.getString(testStrOfs) < key;
-    }
-    bool operator()(Offset testStrOfs,Offset key) {
-        return m_section.getString(testStrOfs) <  m_section.getString(key);
-    }
-};
-
 void DataSection::initStringSet()
 {
     const char * const s_begin = getData(secHeader()->headerByteCount);
@@ -206,9 +618,11 @@ void DataSection::initStringSet()
     size_t const hdrSize = offsetof(BrigData,bytes);
     for (const char *p = s_begin; p < s_end;
          p += hdrSize + align(reinterpret_cast<const BrigData*>(p)->byteCount,ITEM_ALIGNMENT)) { // TBD095 make this cleaner
-         m_stringSet.push_back( getOffset(p) );
+         Offset const o = getOffset(p);
+         if (!std::binary_search(m_unshared.begin(), m_unshared.end(), o)) {
+             m_stringSet.insert(o);
+         }
     }
-    std::sort(m_stringSet.begin(),m_stringSet.end(),StringRefComparer(this));
 }
 
 Offset DataSection::addString(const SRef& newStr)
@@ -216,16 +630,24 @@ Offset DataSection::addString(const SRef& newStr)
     if (m_stringSet.empty() && !isEmpty()) {
         initStringSet();
     }
-    std::vector<Offset>::iterator const i = std::lower_bound(
-        m_stringSet.begin(),m_stringSet.end(),
-        newStr,StringRefComparer(this));
+    m_lookupKey = newStr;
+    StringSet::const_iterator const i = m_stringSet.find(0);
+    m_lookupKey = SRef();
 
-    if (i!=m_stringSet.end() && getString(*i)==newStr) {
+    if (i!=m_stringSet.end()) {
+        ++m_dedupHits;
         return *i;
     }
 
     Offset res = addStringImpl(newStr);
-    m_stringSet.insert(i, res);
+    m_stringSet.insert(res);
+    return res;
+}
+
+Offset DataSection::addUnshared(const SRef& newStr)
+{
+    Offset const res = addStringImpl(newStr);
+    m_unshared.push_back(res);
     return res;
 }
 
@@ -257,26 +679,36 @@ class RefPatcher
     typedef std::map<Offset,Offset> Map;
     const Map& m_old2new;
 
-    void patchRef(Offset& ref) const {
+    bool newRef(Offset ref, Offset& res) const {
         if (ref!=0) {
             Map::const_iterator f = m_old2new.find(ref);
-            if (f!=m_old2new.end()) {
-                ref = (*f).second;
+            if (f!=m_old2new.end() && (*f).second!=ref) {
+                res = (*f).second;
+                return true;
             }
         }
+        return false;
     }
 
-    // \todo1.0: we are preventing deduping of lists in ListRef
-    // implementation and using this to make lists mutable.
-
-    // A better implementation would assume that lists are immutable and
-    // copy them duting update. However this is a rather elaborate task.
+    // references are read through item offsets and written only when they
+    // change, so that untouched sections of a copy-on-write container stay
+    // shared.
 
+    // lists are shared by all references to the same contents, so
+    // a list with changed elements is replaced with an updated copy.
     template<typename I>
     void visit(ListRef<I> list, Item*) const {
+      BrigSectionImpl* itemSection = &list.refSection()->container()->sectionById(I::SECTION);
       int size = list.size();
+      ItemList updated;
+      bool changed = false;
       for(int i=0; i<size; ++i) {
-        patchRef(list.writeAccess(i).deref());
+        Offset ref = list[i].brigOffset();
+        changed |= newRef(ref, ref);
+        updated.push_back(ItemBase(itemSection, ref));
+      }
+      if (changed) {
+        list = updated;
       }
     }
 
@@ -284,7 +716,12 @@ class RefPatcher
     void visit(ListRef<I> list, ...) const { }
 
     template <typename I>
-    void visit(ItemRef<I> ref, Item*) const { patchRef(ref.deref()); }
+    void visit(ItemRef<I> ref, Item*) const {
+        Offset res;
+        if (newRef(ref.brigOffset(), res)) {
+            ref.deref() = res;
+        }
+    }
 
     template <typename I>
     void visit(ItemRef<I>, ... ) const {}
@@ -444,14 +881,281 @@ void BrigContainer::patchDecl2Defs() {
     }
 }
 
+class CollectListRefs
+{
+    std::unordered_set<Offset>& m_lists;
+public:
+    CollectListRefs(std::unordered_set<Offset>& lists) : m_lists(lists) {}
+
+    template <typename I>
+    void operator() ( const ListRef<I>& ref, ...) const {
+        if (ref.deref() != 0) m_lists.insert(ref.deref());
+    }
+
+    template <typename T>
+    void operator() ( const T&, ... ) const {} // all others
+};
+
+void BrigContainer::getMemoryStats(BrigMemoryStats& stats) {
+    stats = BrigMemoryStats();
+    for(int i = 0; i < getNumSections(); ++i) {
+        const BrigSectionImpl& sec = sectionById(i);
+        BrigMemoryStats::Section s;
+        s.name = sec.name();
+        s.byteCount = sec.size();
+        s.capacity = sec.capacity();
+        s.sourceInfoCount = sec.sourceInfos().size();
+        s.sourceInfoBytes = sec.sourceInfos().byteCount();
+        stats.sections.push_back(s);
+    }
+
+    std::unordered_set<Offset> lists;
+    CollectListRefs collectLists(lists);
+    for (Code d = code().begin(), e = code().end(); d != e; d = d.next()) {
+        enumerateFields(d,collectLists);
+    }
+    for (Operand o = operands().begin(), e = operands().end(); o != e; o = o.next()) {
+        enumerateFields(o,collectLists);
+    }
+    const DataSection& data = strings();
+    for (DataSectionIterator i = data.begin(), e = data.end(); i != e; ++i) {
+        size_t const bytes = offsetof(BrigData,bytes) + align((*i).length(),BrigSectionImpl::ITEM_ALIGNMENT);
+        (lists.count(i.offset()) ? stats.listBytes : stats.stringBytes) += bytes;
+    }
+    stats.stringIndexCount = data.indexCount();
+    stats.stringIndexBytes = data.indexByteCount();
+    stats.dedupHits = data.dedupHits();
+    stats.moduleBytes = m_brigModuleBuffer.capacity() + m_brigModuleStorageBytes;
+}
+
+size_t BrigMemoryStats::total() const {
+    size_t res = stringIndexBytes + moduleBytes;
+    for(std::vector<Section>::const_iterator i = sections.begin(); i != sections.end(); ++i) {
+        res += i->capacity + i->sourceInfoBytes;
+    }
+    return res;
+}
+
+size_t BrigMemoryStats::slack() const {
+    size_t res = 0;
+    for(std::vector<Section>::const_iterator i = sections.begin(); i != sections.end(); ++i) {
+        if (i->capacity > i->byteCount) res += i->capacity - i->byteCount;
+    }
+    return res;
+}
+
+std::ostream& operator<<(std::ostream& os, const BrigMemoryStats& stats) {
+    for(std::vector<BrigMemoryStats::Section>::const_iterator i = stats.sections.begin(); i != stats.sections.end(); ++i) {
+        os << "section " << i->name << ": " << i->byteCount << " bytes, "
+           << i->capacity << " allocated, source info " << i->sourceInfoCount
+           << " items in " << i->sourceInfoBytes << " bytes" << std::endl;
+    }
+    os << "strings: " << stats.stringBytes << " bytes" << std::endl;
+    os << "lists: " << stats.listBytes << " bytes" << std::endl;
+    os << "string index: " << stats.stringIndexCount << " entries in "
+       << stats.stringIndexBytes << " bytes, " << stats.dedupHits << " dedup hits" << std::endl;
+    os << "module: " << stats.moduleBytes << " bytes" << std::endl;
+    os << "slack: " << stats.slack() << " bytes" << std::endl;
+    os << "total: " << stats.total() << " bytes" << std::endl;
+    return os;
+}
+
+/// builds the key identifying an operand by its contents. The key is
+/// the raw operand bytes where operand references are replaced with the
+/// offsets of the operands they are merged with and list references are
+/// replaced with the (remapped) list contents.
+class OperandKeyBuilder
+{
+    typedef std::map<Offset,Offset> Map;
+    const Map&   m_old2new;
+    Offset       m_base;
+    std::string& m_key;
+
+    Offset mapRef(Offset ref) const {
+        Map::const_iterator f = m_old2new.find(ref);
+        return f!=m_old2new.end() ? (*f).second : ref;
+    }
+
+    // fields are located by offsets, as reading them must not copy
+    // sections of a copy-on-write container
+    void setField(Offset field, Offset value) {
+        size_t const pos = field - m_base;
+        assert(pos + sizeof(Offset) <= m_key.size());
+        memcpy(&m_key[pos], &value, sizeof(Offset));
+    }
+
+    void append(Offset value) {
+        m_key.append(reinterpret_cast<const char*>(&value), sizeof(Offset));
+    }
+
+    template<typename I>
+    void visit(ListRef<I> list, Operand*) {
+        setField(list.offset2Ref(), 0);
+        int size = list.size();
+        append(size);
+        for(int i=0; i<size; ++i) {
+            append(mapRef(list[i].brigOffset()));
+        }
+    }
+
+    template <typename I>
+    void visit(ListRef<I> list, ...) {
+        setField(list.offset2Ref(), 0);
+        SRef const data = list.data();
+        append(static_cast<Offset>(data.length()));
+        m_key.append(data.begin, data.end);
+    }
+
+    template <typename I>
+    void visit(ItemRef<I> ref, Operand*) { setField(ref.offset2Ref(), mapRef(ref.brigOffset())); }
+
+    template <typename I>
+    void visit(ItemRef<I>, ... ) {}
+
+public:
+    OperandKeyBuilder(const Map& old2new, Operand o, std::string& key)
+        : m_old2new(old2new)
+        , m_base(o.brigOffset())
+        , m_key(key)
+    {
+        const char* const data = reinterpret_cast<const char*>(o.brig());
+        m_key.assign(data, data + o.brigSize());
+    }
+
+    template <typename I>
+    void operator() ( ItemRef<I> ref, ...) { visit(ref, reinterpret_cast<I*>(0)); }
+
+    template <typename I>
+    void operator() ( ListRef<I> ref, ...) { visit(ref, reinterpret_cast<I*>(0)); }
+
+    template <typename T>
+    void operator() ( const T&, ... ) {} // all others
+};
+
+size_t BrigContainer::optimizeOperands() {
+    OperandSection& opers = operands();
+    Offset const oldSize = opers.size();
+
+    std::map<Offset,Offset> old2new;
+    std::vector<Operand> kept;
+    {
+        std::unordered_map<std::string,Offset> unique;
+        std::string key;
+        Offset newOffset = opers.secHeader()->headerByteCount;
+        for (Operand o = opers.begin(), e = opers.end(); o != e; o = o.next()) {
+            OperandKeyBuilder keyBuilder(old2new, o, key);
+            enumerateFields(o, keyBuilder);
+            std::pair<std::unordered_map<std::string,Offset>::iterator,bool> const ins =
+                unique.insert(std::make_pair(key, newOffset));
+            if (ins.second) {
+                kept.push_back(o);
+                newOffset += o.brigSize();
+            }
+            old2new[o.brigOffset()] = ins.first->second;
+        }
+        if (newOffset == oldSize) {
+            return 0;
+        }
+    }
+
+    RefPatcher<Operand> refPatcher(old2new);
+    for (Code d = code().begin(), e = code().end(); d != e; d = d.next()) {
+        enumerateFields(d,refPatcher);
+    }
+    for (Operand o = opers.begin(), e = opers.end(); o != e; o = o.next()) {
+        enumerateFields(o,refPatcher);
+    }
+
+    BrigSectionImpl::Buffer buf(opers.getData(0), opers.getData(opers.secHeader()->headerByteCount));
+    for (std::vector<Operand>::const_iterator i = kept.begin(); i != kept.end(); ++i) {
+        const char* const src = reinterpret_cast<const char*>(i->brig());
+        buf.insert(buf.end(), src, src + i->brigSize());
+    }
+    opers.swapInData(buf, old2new);
+    return oldSize - opers.size();
+}
+
+/// placement of the section index and sections in the Brig module written
+/// for a container, see BrigContainer::write.
+struct BrigModuleLayout {
+    uint64_t              sectionIndex;
+    std::vector<uint64_t> sectionOffsets;
+    uint64_t              byteCount;
+};
+
+static void computeLayout(const BrigContainer& c, BrigModuleLayout& layout) {
+    size_t const numSections = c.getNumSections();
+    uint64_t pos = align(sizeof(BrigModuleHeader), 8);
+    layout.sectionIndex = pos;
+    pos += numSections * sizeof(uint64_t);
+    layout.sectionOffsets.resize(numSections);
+    for(size_t i=0; i < numSections; ++i) {
+        pos = align(pos, 16);
+        layout.sectionOffsets[i] = pos;
+        pos = align(pos + c.sectionById((int)i).size(), 4);
+    }
+    layout.byteCount = align(pos, 16);
+}
+
+static void initModuleHeader(BrigModuleHeader& hdr, unsigned sectionCount) {
+    const char magic[] = "HSA BRIG";
+    memcpy(hdr.identification, magic,
+           (std::min)(sizeof magic - 1, sizeof hdr.identification));
+    std::fill(&hdr.hash[0], &hdr.hash[sizeof hdr.hash/sizeof hdr.hash[0]], 0);
+    hdr.reserved = 0;
+
+    hdr.brigMajor = BRIG_VERSION_HSAIL_MAJOR;
+    hdr.brigMinor = BRIG_VERSION_HSAIL_MINOR;
+
+    hdr.sectionCount = sectionCount;
+    hdr.sectionIndex = 0; // will set later
+    hdr.byteCount = 0;
+}
+
 bool BrigContainer::makeRO() {
     if (isROContainer()) return true;
 
-    std::vector<char> buf;
-    if (!write(*BrigIO::vectorWritingAdapter(buf)))
+    BrigModuleLayout layout;
+    computeLayout(*this, layout);
+    if (layout.byteCount >= (std::numeric_limits<size_t>::max)()) {
         return false;
+    }
 
-    setContents(buf);
+    // the module is written sequentially into uninitialized memory so that
+    // pages are committed only as they are filled; padding is zeroed explicitly
+    const size_t byteCount = (size_t)layout.byteCount;
+    std::shared_ptr<const char> storage(new char[byteCount],
+                                        std::default_delete<char[]>());
+    char* const buf = const_cast<char*>(storage.get());
+
+    BrigModuleHeader& hdr = *reinterpret_cast<BrigModuleHeader*>(buf);
+    initModuleHeader(hdr, getNumSections());
+    hdr.sectionIndex = layout.sectionIndex;
+    hdr.byteCount = layout.byteCount;
+
+    size_t pos = sizeof hdr;
+    const size_t indexBytes = layout.sectionOffsets.size() * sizeof layout.sectionOffsets[0];
+    memset(buf + pos, 0, (size_t)layout.sectionIndex - pos);
+    memcpy(buf + (size_t)layout.sectionIndex, &layout.sectionOffsets[0], indexBytes);
+    pos = (size_t)layout.sectionIndex + indexBytes;
+
+    ContentHasher hasher;
+    for(int i=0; i < getNumSections(); ++i) {
+        const BrigSectionImpl& s = sectionById(i);
+        hashSection(hasher, s);
+        const size_t offset = (size_t)layout.sectionOffsets[i];
+        memset(buf + pos, 0, offset - pos);
+        memcpy(buf + offset, s.getData(0), s.size());
+        pos = offset + s.size();
+        // release section data as soon as it is copied, so that memory
+        // peaks at about one copy of the module
+        m_sections[i].reset();
+    }
+    memset(buf + pos, 0, byteCount - pos);
+    setModuleHash(hdr, hasher.digest());
+
+    setContents(storage);
+    m_brigModuleStorageBytes = byteCount;
     return true;
 }
 
@@ -462,9 +1166,143 @@ void BrigContainer::setContents(std::vector<char>& buf) {
     SectionVector secs;
     initSections(*hdr, secs);
 
+    resetLazyState();
     m_brigModuleBuffer.swap(buf);
+    m_brigModuleStorage.reset();
+    m_brigModuleStorageBytes = 0;
     m_sections.swap(secs);
     m_brigModuleHeader = hdr;
+    m_recordedHash = getModuleHash(*hdr);
+}
+
+void BrigContainer::makeRW() {
+    if (!isROContainer()) return;
+    makeCopyOnWrite();
+    for(SectionVector::iterator i = m_sections.begin(); i != m_sections.end(); ++i) {
+        (*i)->makeWritable();
+    }
+    std::vector<char>().swap(m_brigModuleBuffer);
+    m_brigModuleStorage.reset();
+    m_brigModuleStorageBytes = 0;
+}
+
+void BrigContainer::makeCopyOnWrite() {
+    if (!isROContainer()) return;
+    for(SectionVector::iterator i = m_sections.begin(); i != m_sections.end(); ++i) {
+        (*i)->setCopyOnWrite();
+    }
+    // the module buffer or storage is kept as long as sections refer to it
+    m_brigModuleHeader = nullptr;
+}
+
+void BrigContainer::setContents(const std::shared_ptr<const char>& storage) {
+    const BrigModuleHeader* const hdr =
+        (const BrigModuleHeader*)storage.get();
+
+    SectionVector secs;
+    initSections(*hdr, secs);
+
+    resetLazyState();
+    std::vector<char>().swap(m_brigModuleBuffer);
+    m_brigModuleStorage = storage;
+    m_brigModuleStorageBytes = 0;
+    m_sections.swap(secs);
+    m_brigModuleHeader = hdr;
+    m_recordedHash = getModuleHash(*hdr);
+}
+
+void BrigContainer::setLazyContents(const std::shared_ptr<ReadAdapter>& src,
+                                    const BrigModuleHeader& hdr,
+                                    const std::vector<uint64_t>& sectionOffsets) {
+    assert(sectionOffsets.size() >= BRIG_SECTION_INDEX_IMPLEMENTATION_DEFINED);
+    SectionVector secs(sectionOffsets.size());
+    m_sections.swap(secs);
+    std::vector<char>().swap(m_brigModuleBuffer);
+    m_brigModuleStorage.reset();
+    m_brigModuleStorageBytes = 0;
+    m_brigModuleHeader = nullptr;
+    m_recordedHash = getModuleHash(hdr);
+    m_lazySource = src;
+    m_lazySectionOffsets = sectionOffsets;
+    m_lazyLoadFailed = false;
+
+    std::vector<std::string> names(sectionOffsets.size());
+    for(size_t i = 0; i < names.size(); ++i) {
+        BrigSectionHeader hdr;
+        // sections whose header cannot be read fail to load on first access
+        if (src->pread((char*)&hdr, sizeof hdr, sectionOffsets[i]) == 0 && hdr.nameLength > 0) {
+            names[i].resize(hdr.nameLength);
+            if (src->pread(&names[i][0], names[i].size(), sectionOffsets[i] + offsetof(BrigSectionHeader, name))) {
+                names[i].clear();
+            }
+        }
+    }
+    m_lazySectionNames.swap(names);
+    m_lazyOnce.reset(new std::once_flag[sectionOffsets.size()]);
+    m_lazyPending = (int)sectionOffsets.size();
+}
+
+static BrigSectionImpl* newEmptySection(int index, BrigContainer* c) {
+    switch(index) {
+    case BRIG_SECTION_INDEX_DATA:    return new DataSection(c);
+    case BRIG_SECTION_INDEX_CODE:    return new CodeSection(c);
+    case BRIG_SECTION_INDEX_OPERAND: return new OperandSection(c);
+    default:                         return new BrigSectionRaw(SRef(), c);
+    }
+}
+
+void BrigContainer::loadLazySection(int index) const {
+    std::call_once(m_lazyOnce[index], &BrigContainer::readLazySection, this, index);
+}
+
+void BrigContainer::readLazySection(int index) const {
+    assert(m_lazySource && "section is neither loaded nor can be loaded");
+    BrigContainer* const self = const_cast<BrigContainer*>(this);
+    std::unique_ptr<BrigSectionImpl> sec(newEmptySection(index, self));
+
+    const ReadAdapter& r = *m_lazySource;
+    uint64_t const offset = m_lazySectionOffsets[index];
+    BrigSectionHeader hdr;
+    BrigSectionImpl::Buffer data;
+    if (r.pread((char*)&hdr, sizeof hdr, offset) == 0) {
+        data.resize(hdr.byteCount);
+        if (r.pread(&data[0], data.size(), offset) ||
+            verifySection(index, SRef(&data[0], &data[0] + data.size()), r.errs)) {
+            data.clear();
+        }
+    }
+    if (!data.empty()) {
+        sec->swapInData(data);
+    } else {
+        // accessors return references, so the section is left empty and
+        // the failure is recorded for lazyLoadFailed
+        r.errs << "cannot load section #" << index << std::endl;
+        m_lazyLoadFailed = true;
+    }
+    m_sections[index] = std::move(sec);
+
+    // the last section loaded releases the source, no other load uses it then
+    if (--m_lazyPending == 0) {
+        self->m_lazySource.reset();
+    }
+}
+
+void BrigContainer::resetLazyState() {
+    m_lazySource.reset();
+    m_lazySectionOffsets.clear();
+    m_lazySectionNames.clear();
+    m_lazyOnce.reset();
+    m_lazyPending = 0;
+}
+
+void BrigContainer::dropLazySections() {
+    if (!m_lazyOnce) return;
+    for(int i = 0; i < BRIG_SECTION_INDEX_IMPLEMENTATION_DEFINED; ++i) {
+        if (!m_sections[i]) {
+            m_sections[i].reset(newEmptySection(i, this));
+        }
+    }
+    resetLazyState();
 }
 
 void BrigContainer::setData(const void *data, size_t size)
@@ -472,76 +1310,106 @@ void BrigContainer::setData(const void *data, size_t size)
   clear();
   std::vector<char> tmpBuf((const char*)data, (const char*)data + size);
   m_brigModuleBuffer.swap(tmpBuf);
+  m_brigModuleStorage.reset();
+  m_brigModuleStorageBytes = 0;
   m_brigModuleHeader = (const BrigModuleHeader*) &m_brigModuleBuffer[0];
+  m_recordedHash = getModuleHash(*m_brigModuleHeader);
   m_sections.clear();
   initSections(*m_brigModuleHeader, m_sections);
 }
 
-static bool writeSection(WriteAdapter& w,
-                         const BrigContainer& c,
-                         int index,
-                         uint64_t& secStartOut) {
-    const BrigSectionImpl& s = c.sectionById(index);
-    w.writeAlignPad(16);
-    uint64_t const secStart = w.getPos();
-    if (w.write(s.getData(0), s.size())) {
-        w.errs << "cannot write section data at " << index << " index" << std::endl;
-        return false;
+/// append fragment of data to be written at position at, preceded by
+/// zero padding from the current position pos.
+static void addFragment(std::vector<WriteAdapter::Fragment>& frags, uint64_t& pos,
+                        uint64_t at, const char* data, size_t numBytes) {
+    static const char zeropad[16] = { 0 };
+    assert(pos <= at && at - pos <= sizeof zeropad);
+    if (at > pos) {
+        WriteAdapter::Fragment const pad = { zeropad, (size_t)(at - pos) };
+        frags.push_back(pad);
     }
-    w.writeAlignPad(4);
-    secStartOut = secStart;
-    return true;
+    WriteAdapter::Fragment const f = { data, numBytes };
+    frags.push_back(f);
+    pos = at + numBytes;
 }
 
-static bool writeContents(WriteAdapter& w,
-                          const BrigContainer& c,
-                          BrigModuleHeader& hdr,
-                          uint64_t sectionIndex[]) {
-    if (w.write(hdr)) {
-        w.errs << "cannot write BrigModuleHeader" << std::endl;
-        return false;
+uint64_t BrigContainer::contentHash() const {
+    if (isROContainer() && m_recordedHash != 0) {
+        return m_recordedHash;
+    }
+    ContentHasher hasher;
+    for(int i=0; i < getNumSections(); ++i) {
+        hashSection(hasher, sectionById(i));
     }
+    return hasher.digest();
+}
 
-    w.writeAlignPad(8);
-    hdr.sectionIndex = w.getPos();
-    if (w.write((const char*)&sectionIndex[0], hdr.sectionCount * sizeof sectionIndex[0])) {
-        w.errs << "cannot write section index" << std::endl;
+bool BrigContainer::verifyContentHash(std::ostream& errs) const {
+    if (m_recordedHash == 0) return true;
+    ContentHasher hasher;
+    for(int i=0; i < getNumSections(); ++i) {
+        hashSection(hasher, sectionById(i));
+    }
+    if (hasher.digest() != m_recordedHash) {
+        errs << "Brig module content hash mismatch" << std::endl;
         return false;
     }
+    return true;
+}
 
-    for(int i=0; i < (int)hdr.sectionCount; ++i) {
-        if (!writeSection(w, c, i, sectionIndex[i])) {
-            return false;
-        }
+void BrigContainer::getModuleImage(BrigModuleImage& image) const {
+    BrigModuleLayout layout;
+    computeLayout(*this, layout);
+
+    BrigModuleHeader& hdr = image.header;
+    initModuleHeader(hdr, getNumSections());
+    hdr.sectionIndex = layout.sectionIndex;
+    hdr.byteCount = layout.byteCount;
+    image.sectionIndex.swap(layout.sectionOffsets);
+
+    std::vector<WriteAdapter::Fragment>& frags = image.fragments;
+    frags.clear();
+    frags.reserve(2 * getNumSections() + 4);
+    uint64_t pos = 0;
+    addFragment(frags, pos, 0, (const char*)&hdr, sizeof hdr);
+    addFragment(frags, pos, hdr.sectionIndex, (const char*)&image.sectionIndex[0],
+                image.sectionIndex.size() * sizeof image.sectionIndex[0]);
+    ContentHasher hasher;
+    for(int i=0; i < getNumSections(); ++i) {
+        const BrigSectionImpl& s = sectionById(i);
+        hashSection(hasher, s);
+        addFragment(frags, pos, image.sectionIndex[i], s.getData(0), s.size());
     }
-
-    w.writeAlignPad(16);
-    hdr.byteCount = w.getPos();
-    return true;
+    addFragment(frags, pos, hdr.byteCount, NULL, 0);
+    // the header fragment refers to hdr, so the hash is written with it
+    setModuleHash(hdr, hasher.digest());
 }
 
 bool BrigContainer::write(WriteAdapter& w) const {
-    BrigModuleHeader hdr;
-
-    const char magic[] = "HSA BRIG";
-    memcpy(hdr.identification, magic,
-           (std::min)(sizeof magic - 1, sizeof hdr.identification));
-    std::fill(&hdr.hash[0], &hdr.hash[sizeof hdr.hash/sizeof hdr.hash[0]], 0);
-    hdr.reserved = 0;
-
-    hdr.brigMajor = BRIG_VERSION_HSAIL_MAJOR;
-    hdr.brigMinor = BRIG_VERSION_HSAIL_MINOR;
-
-    hdr.sectionCount = getNumSections();
-    hdr.sectionIndex = 0; // will set later
-    hdr.byteCount = 0;
+    BrigModuleImage image;
+    getModuleImage(image);
+    if (w.writev(&image.fragments[0], image.fragments.size())) {
+        w.errs << "cannot write Brig module" << std::endl;
+        return false;
+    }
+    return true;
+}
 
-    std::vector<uint64_t> sectionIndex;
-    sectionIndex.resize(hdr.sectionCount);
+bool readContainerLazily(const std::shared_ptr<ReadAdapter>& r, BrigContainer& c) {
+    if (BrigIO::validateBrigBlob(*r)!=0) return false;
 
-    NullWriteAdapter nullWA(w.errs);
-    return writeContents(nullWA, *this, hdr, &sectionIndex[0]) &&
-           writeContents(w, *this, hdr, &sectionIndex[0]);
+    BrigModuleHeader hdr;
+    if (r->pread((char*)&hdr, sizeof hdr, 0)) {
+        r->errs << "cannot read BrigModuleHeader" << std::endl;
+        return false;
+    }
+    std::vector<uint64_t> sectionOffsets(hdr.sectionCount);
+    if (r->pread((char*)&sectionOffsets[0], sectionOffsets.size() * sizeof sectionOffsets[0], hdr.sectionIndex)) {
+        r->errs << "cannot read section index" << std::endl;
+        return false;
+    }
+    c.setLazyContents(r, hdr, sectionOffsets);
+    return true;
 }
 
 static bool readSection(ReadAdapter& r,
@@ -565,7 +1433,7 @@ static bool readSection(ReadAdapter& r,
     return c.loadSection(index, secData, true, r.errs)==0;
 }
 
-bool readContainer(ReadAdapter& r, BrigContainer& c, bool writeable) {
+bool readContainer(ReadAdapter& r, BrigContainer& c, int mode) {
     if (BrigIO::validateBrigBlob(r)!=0) return false;
 
     BrigModuleHeader hdr;
@@ -578,28 +1446,41 @@ bool readContainer(ReadAdapter& r, BrigContainer& c, bool writeable) {
         return false;
     }
 
-    if (!writeable) {
+    if (mode == LOAD_WRITABLE) {
+        // sections are read one at a time, so that memory peaks at about
+        // one copy of the module
+        std::vector<uint64_t> sectionIndex;
+        sectionIndex.resize(hdr.sectionCount);
+
+        if (r.pread((char*)&sectionIndex[0],
+            sizeof sectionIndex[0] * hdr.sectionCount,
+            hdr.sectionIndex)) {
+            r.errs << "cannot read section index" << std::endl;
+            return false;
+        }
+        for(int i=0; i < (int)hdr.sectionCount; ++i) {
+            if (!readSection(r, c, i, sectionIndex[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // refer to the adapter's memory directly when it is suitably aligned
+    std::shared_ptr<const char> const storage = r.sharedData();
+    if (storage && (reinterpret_cast<uintptr_t>(storage.get()) % 16) == 0) {
+        c.setContents(storage);
+    } else {
         std::vector<char> buf;
         buf.resize((size_t)hdr.byteCount);
         if (r.pread(&buf[0], (size_t)hdr.byteCount, 0)) {
             r.errs << "cannot read Brig" << std::endl;
+            return false;
         }
         c.setContents(buf);
-    } else {
-      std::vector<uint64_t> sectionIndex;
-      sectionIndex.resize(hdr.sectionCount);
-
-      if (r.pread((char*)&sectionIndex[0],
-          sizeof sectionIndex[0] * hdr.sectionCount,
-          hdr.sectionIndex)) {
-          r.errs << "cannot read section index" << std::endl;
-          return false;
-      }
-      for(int i=0; i < (int)hdr.sectionCount; ++i) {
-          if (!readSection(r, c, i, sectionIndex[i])) {
-              return false;
-          }
-      }
+    }
+    if (mode == LOAD_COPY_ON_WRITE) {
+        c.makeCopyOnWrite();
     }
     return true;
 }
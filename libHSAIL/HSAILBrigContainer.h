@@ -49,12 +49,15 @@
 #include <string>
 #include <cstring>
 #include <map>
+#include <unordered_set>
 #include <vector>
 #include <algorithm>
 #include <cassert>
 #include <functional>
 #include <iosfwd>
 #include <memory>
+#include <atomic>
+#include <mutex>
 #include <limits>
 #include <climits>
 #include <stdint.h>
@@ -67,6 +70,8 @@ class Code;
 class Operand;
 
 /// this structure is used to pass source location for items. Text coordinates are zero based.
+/// source position of an item. Lookups of items without one return the
+/// default SourceInfo, whose line is -1.
 struct SourceInfo
 {
     SourceInfo(int l=-1, int c=-1) : line(l), column(c) {}
@@ -84,23 +89,180 @@ template <> struct GetSectionID<Code>      { static const BrigSectionIndex id=BR
 template <> struct GetSectionID<Operand>   { static const BrigSectionIndex id=BRIG_SECTION_INDEX_OPERAND;   };
 
 
+/// contiguous storage of section data. Where possible the data lives in a
+/// reservation of virtual address space that is committed as the data grows,
+/// so appending never moves existing data unless the reservation is
+/// exhausted. Otherwise a heap vector with geometric growth is used, which
+/// can be swapped with a std::vector without copying.
+class SectionBuffer
+{
+    char*  m_data;
+    size_t m_size;
+    size_t m_committed; // bytes usable without moving or committing
+    size_t m_reserved;  // bytes of address space reserved
+    bool   m_mapped;    // whether m_data is a virtual memory reservation
+    std::vector<char> m_heap; // data of unmapped buffer, always m_size bytes
+
+    SectionBuffer(const SectionBuffer&);
+    SectionBuffer& operator=(const SectionBuffer&);
+
+    enum Storage { ANY_STORAGE, MAPPED_STORAGE, HEAP_STORAGE };
+
+    void release();
+    void relocate(size_t numBytes, Storage storage = ANY_STORAGE);
+    void ensureCapacity(size_t numBytes);
+    void setSize(size_t numBytes);
+    void adoptHeap();
+
+public:
+    SectionBuffer()
+        : m_data(NULL), m_size(0), m_committed(0), m_reserved(0), m_mapped(false) {}
+    ~SectionBuffer() { release(); }
+
+    bool empty() const { return m_size == 0; }
+    size_t size() const { return m_size; }
+    /// bytes of memory backing the buffer.
+    size_t capacity() const { return m_committed; }
+    char* data() { return m_data; }
+    const char* data() const { return m_data; }
+
+    /// make room for numBytes so that growing up to this size keeps data in place.
+    void reserve(size_t numBytes);
+
+    /// make room for numBytes as reserve does, but only if it can be done by
+    /// reserving address space, without committing memory. Otherwise this is
+    /// a no-op, and the buffer grows as usual.
+    void reserveUncommitted(size_t numBytes);
+
+    void resize(size_t numBytes, char fill=0);
+    void assign(const char* start, const char* end);
+    void insert(size_t offset, size_t numBytes, char fill);
+    void insert(size_t offset, const char* start, const char* end);
+    void erase(size_t offset, size_t numBytes);
+
+    void swap(SectionBuffer& other) {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        std::swap(m_committed, other.m_committed);
+        std::swap(m_reserved, other.m_reserved);
+        std::swap(m_mapped, other.m_mapped);
+        // vector storage moves along with its pointer
+        m_heap.swap(other.m_heap);
+    }
+
+    /// take over the contents of v without copying them, v is cleared.
+    void swap(std::vector<char>& v);
+};
+
+/// sorted mapping of item offsets to source locations. Entries are kept as
+/// a stream of variable-length deltas split into blocks of BLOCK_SIZE entries,
+/// each block starting with an uncompressed checkpoint. Lookup is a binary
+/// search over checkpoints followed by decoding of at most one block.
+/// Entries are expected to be added mostly in ascending order of offsets,
+/// other additions re-encode the block they fall into.
+class SourceInfoTable
+{
+public:
+    typedef std::pair<Offset, SourceInfo> Entry;
+    typedef std::vector<Entry> Entries;
+
+    SourceInfoTable() : m_count(0), m_lastBlockSize(0) {}
+
+    bool empty() const { return m_count == 0; }
+
+    /// number of entries.
+    size_t size() const { return m_count; }
+
+    /// number of bytes occupied by the encoded entries.
+    size_t byteCount() const {
+        return m_checkpoints.capacity() * sizeof(Checkpoint) + m_bytes.capacity();
+    }
+
+    void clear();
+    void swap(SourceInfoTable& other);
+
+    /// set source info of an item at offset o, replacing the previous one.
+    void add(Offset o, const SourceInfo& si);
+
+    /// looks up source info of an item at offset o.
+    /// @return false if there is none, leaving res unchanged.
+    bool find(Offset o, SourceInfo& res) const;
+
+    /// decode all entries in ascending order of offsets.
+    void entries(Entries& res) const;
+
+    /// replace contents with entries sorted by offset without duplicates.
+    void assign(const Entries& src);
+
+private:
+    enum { BLOCK_SIZE = 64 };
+
+    struct Checkpoint {
+        Offset     offset;
+        SourceInfo si;
+        uint32_t   pos; // position of the rest of the block in m_bytes
+    };
+    typedef std::vector<Checkpoint> Checkpoints;
+    typedef std::vector<uint8_t>    Bytes;
+
+    Checkpoints        m_checkpoints;
+    Bytes              m_bytes;
+    size_t             m_count;
+    Entry              m_last;          // base of the delta for the next appended entry
+    unsigned           m_lastBlockSize; // number of entries in the last block
+
+    size_t blockEnd(size_t block) const {
+        return block + 1 < m_checkpoints.size() ? m_checkpoints[block + 1].pos : m_bytes.size();
+    }
+    /// returns the last block starting at or before o.
+    size_t findBlock(Offset o) const;
+    void decodeBlock(size_t block, Entries& res) const;
+
+    static void encode(const Entry* begin, const Entry* end, Checkpoints& cps, Bytes& bytes);
+    static void encodeDelta(const Entry& prev, const Entry& e, Bytes& bytes);
+    static void decodeDelta(const uint8_t*& p, Entry& e);
+};
+
 /// implementation of a Brig section. This is a buffer of plain raw data
 /// with insert/append/delete modificators.
-/// Note that as the buffer is resizable, i.e. the data is movable,
-/// appending a new item may invalidate all direct references to the data,
-/// but not iterators, as iterators use offsets.
+/// Note that appending a new item normally keeps the data in place (see
+/// SectionBuffer), but other modifications may move it, invalidating all
+/// direct references to the data, but not iterators, as iterators use offsets.
 class BrigSectionImpl
 {
 public:
-    typedef std::vector<char> Buffer; // TBD possibly switch to a more optimal container
+    typedef std::vector<char> Buffer;
 
+    /// replace section data with the contents of src, src is cleared.
     virtual void swapInData(Buffer& src) {
-        assert(hasOwnBuffer());
+        assert(hasOwnBuffer() || m_copyOnWrite);
         m_buffer.swap(src);
+        m_copyOnWrite = false;
         m_sourceInfo.clear();
         syncWithBuffer();
     }
 
+    /// replace section data with src which holds the items of this section
+    /// moved to new offsets. Source info is moved along with the items,
+    /// old2new maps old item offsets to new ones.
+    void swapInData(Buffer& src, const std::map<Offset,Offset>& old2new) {
+        assert(hasOwnBuffer() || m_copyOnWrite);
+        m_buffer.swap(src);
+        m_copyOnWrite = false;
+        SourceInfoTable::Entries oldSourceInfo, newSourceInfo;
+        m_sourceInfo.entries(oldSourceInfo);
+        newSourceInfo.reserve(oldSourceInfo.size());
+        for(SourceInfoTable::Entries::const_iterator i = oldSourceInfo.begin(); i != oldSourceInfo.end(); ++i) {
+            std::map<Offset,Offset>::const_iterator const f = old2new.find(i->first);
+            // items merged into an earlier one keep the source info of that item
+            if (f != old2new.end() && (newSourceInfo.empty() || newSourceInfo.back().first < f->second)) {
+                newSourceInfo.push_back(std::make_pair(f->second, i->second));
+            }
+        }
+        m_sourceInfo.assign(newSourceInfo);
+        syncWithBuffer();
+    }
+
 private:
     class BrigContainer    *m_container;
 
@@ -108,15 +270,27 @@ private:
 
     std::function<void()>       m_syncCallback;
 
-    Buffer               m_buffer;
+    SectionBuffer        m_buffer;
+
+    bool                 m_copyOnWrite; // data is shared until modified
+
+    SourceInfoTable      m_sourceInfo;
+
+    bool                 m_annotate; // whether annotate records source info
 
-    typedef std::vector< std::pair<Offset, SourceInfo > > SectionSourceInfo;
-    SectionSourceInfo    m_sourceInfo;
+    size_t               m_batchEnd; // end of room reserved by beginAppendBatch, 0 if none
 
     bool hasOwnBuffer() const { return !m_buffer.empty(); }
 
+    void materialize(Offset numBytes) {
+        assert(m_copyOnWrite && "section of RO container cannot be modified");
+        m_buffer.assign(getData(0), getData(numBytes));
+        m_copyOnWrite = false;
+        syncWithBuffer();
+    }
+
     void syncWithBuffer() {
-      m_data = (BrigSectionHeader*)&m_buffer[0];
+      m_data = (BrigSectionHeader*)m_buffer.data();
       Offset end = static_cast<uint32_t>(m_buffer.size());
       assert(secHeader()->headerByteCount > 0);
       assert(secHeader()->headerByteCount <= end);
@@ -129,7 +303,8 @@ private:
 protected:
     // allow to swap only for 'final' classes
     void swapData(BrigSectionImpl& other) {
-        assert(hasOwnBuffer() && other.hasOwnBuffer());
+        makeWritable();
+        other.makeWritable();
         m_buffer.swap(other.m_buffer);
         m_sourceInfo.swap(other.m_sourceInfo);
         syncWithBuffer();
@@ -153,6 +328,9 @@ public:
     BrigSectionImpl(const void* ptr, class BrigContainer *container=NULL)
         : m_container(container)
         , m_data((const BrigSectionHeader*)ptr)
+        , m_copyOnWrite(false)
+        , m_annotate(true)
+        , m_batchEnd(0)
     {
     }
 
@@ -165,13 +343,41 @@ public:
     void container(class BrigContainer* c) { m_container = c; }
     /// @}
 
+    /// bytes of memory allocated for the section data, 0 if the data is shared.
+    size_t capacity() const { return m_buffer.capacity(); }
+
+    /// source info recorded for items of the section.
+    const SourceInfoTable& sourceInfos() const { return m_sourceInfo; }
+
     /// returns whether section doesnt' contain items.
     bool isEmpty() const {
       return size() <= secHeader()->headerByteCount;
     }
 
+    /// mark data the section refers to as shared. Such section keeps
+    /// referring to it until the section is modified, see makeWritable.
+    void setCopyOnWrite() {
+        assert(!hasOwnBuffer());
+        m_copyOnWrite = true;
+    }
+
+    /// returns whether the section still refers to shared data.
+    bool isCopyOnWrite() const { return m_copyOnWrite; }
+
+    /// copy shared data of the section so that it can be modified. This
+    /// is done implicitly by all modificators of the section and by item
+    /// proxies (see getWritableData), but has to be called explicitly before
+    /// writing through raw pointers to the data, e.g. ItemBase::brig().
+    void makeWritable() {
+        if (!hasOwnBuffer()) {
+            materialize(size());
+        }
+    }
+
     virtual void clear() {
-        assert(hasOwnBuffer());
+        if (!hasOwnBuffer()) {
+            materialize(secHeader()->headerByteCount);
+        }
         m_buffer.resize(secHeader()->headerByteCount);
         syncWithBuffer();
         m_sourceInfo.clear();
@@ -180,8 +386,7 @@ public:
     void setData(const void* data) {
         clear();
         const BrigSectionHeader* header = (const BrigSectionHeader*)data;
-        Buffer tmpBuf((const char*)data, (const char*)data + header->byteCount);
-        m_buffer.swap(tmpBuf);
+        m_buffer.assign((const char*)data, (const char*)data + header->byteCount);
         syncWithBuffer();
     }
 
@@ -190,8 +395,17 @@ public:
     }
 
     void reserve(size_t numBytes) {
-        assert(hasOwnBuffer());
+        makeWritable();
         m_buffer.reserve(numBytes);
+        syncWithBuffer();
+    }
+
+    /// hint that the section is going to grow to about numBytes, see
+    /// SectionBuffer::reserveUncommitted.
+    void reserveUncommitted(size_t numBytes) {
+        makeWritable();
+        m_buffer.reserveUncommitted(numBytes);
+        syncWithBuffer();
     }
 
     SRef name() const {
@@ -216,28 +430,62 @@ public:
     char* getData(Offset offset) { return (char*)m_data + offset; }
     const char* getData(Offset offset) const { return (const char*)m_data + offset; }
 
+    /// return data at a given offset for modification in place. Shared
+    /// data of a copy-on-write section is copied first, which invalidates
+    /// pointers to the section data, but not offsets.
+    template <typename T>
+    T* getWritableData(Offset offset) {
+        if (m_copyOnWrite) {
+            materialize(size());
+        }
+        return getData<T>(offset);
+    }
+
     /// insert uninitialized data into the section.
     /// May invalidate pointers to the section data.
     /// @param offset - offset where data should be inserted.
     /// @param numBytes - number of bytes to be inserted.
     /// @param fill - filling value
     char* insertData(Offset offset, unsigned numBytes, char fill='\xFF') {
-        assert(hasOwnBuffer());
+        if (offset + numBytes <= m_batchEnd && offset == m_buffer.size()) {
+            // appending within a batch, the data stays in place
+            m_buffer.resize(offset + numBytes, fill);
+            secHeader()->byteCount = offset + numBytes;
+            return getData(offset);
+        }
+        makeWritable();
         assert(offset <= m_buffer.size());
-        m_buffer.insert(m_buffer.begin() + offset,numBytes,fill);
+        m_buffer.insert(offset,numBytes,fill);
         syncWithBuffer();
         return getData(offset);
     }
 
+    /// start appending a batch of items taking about numBytes. Room for the
+    /// items is reserved up front, so each insertData at the end only bumps
+    /// the section size and the full resync is done once by endAppendBatch.
+    /// Items are still appended and initialized by their own calls.
+    void beginAppendBatch(size_t numBytes) {
+        assert(m_batchEnd == 0 && "append batches cannot be nested");
+        makeWritable();
+        reserve(m_buffer.size() + numBytes);
+        m_batchEnd = m_buffer.size() + numBytes;
+    }
+
+    /// finish the batch started by beginAppendBatch.
+    void endAppendBatch() {
+        m_batchEnd = 0;
+        syncWithBuffer();
+    }
+
     /// insert uninitialized data into the section.
     /// May invalidate pointers to the section data.
     /// @param offset - offset where data should be inserted.
     /// @param start - the begining of the data being inserted.
     /// @param end - the ending of the data being inserted.
     char* insertData(Offset offset, const char* start, const char* end) {
-        assert(hasOwnBuffer());
+        makeWritable();
         assert(offset <= m_buffer.size());
-        m_buffer.insert(m_buffer.begin() + offset,start,end);
+        m_buffer.insert(offset,start,end);
         syncWithBuffer();
         return getData(offset);
     }
@@ -246,9 +494,9 @@ public:
     /// @param offset - offset from where to start delete.
     /// @param numBytes - num bytes to delete.
     void deleteData(Offset   offset, unsigned numBytes) {
-        assert(hasOwnBuffer());
+        makeWritable();
         assert(offset + numBytes <= m_buffer.size());
-        m_buffer.erase(m_buffer.begin() + offset,m_buffer.begin() + offset + numBytes);
+        m_buffer.erase(offset,numBytes);
         syncWithBuffer();
     }
 
@@ -303,6 +551,7 @@ public:
 
     template <typename Item>
     unsigned grow(Item item, size_t reqSize) {
+        makeWritable();
         assert((item.brigOffset() + item.brig()->byteCount) == size());
 
         Offset const oldNumBytes = item.brig()->byteCount;
@@ -326,46 +575,30 @@ public:
     // TBD template here is redundand and 'i' arg should have
     // 'typename Item::Kind' type but its not defined at this point yet
     template<class Item>
-    const SourceInfo* sourceInfo( const Item& i ) const {
+    SourceInfo sourceInfo( const Item& i ) const {
         return sourceInfo(i.brigOffset());
     }
 
-    const SourceInfo* sourceInfo(Offset o) const {
-      if (o == 0) return NULL;
-        SectionSourceInfo::const_iterator const p =
-            std::lower_bound(m_sourceInfo.begin(),m_sourceInfo.end(),o,&BrigSectionImpl::xless);
-        return p!=m_sourceInfo.end() && p->first==o ? &p->second : NULL;
+    /// returns source info of an item at offset o, with line -1 if there
+    /// is none.
+    SourceInfo sourceInfo(Offset o) const {
+        SourceInfo res;
+        if (o != 0) m_sourceInfo.find(o, res);
+        return res;
     }
 
+    /// enable or disable recording of source info by annotate. Sections
+    /// whose items are not used in diagnostics may save on it.
+    void setAnnotation(bool enable) { m_annotate = enable; }
+
     // TBD template here is redundand and 'i' arg should have
     // 'typename Item::Kind' type but its not defined at this point yet
     template <class Item>
     void annotate(const Item& i, const SourceInfo& si) {
-        Offset const ofs = i.brigOffset();
-        // on write most of offsets come in ascending order
-        // so do a shortcut check
-        if (m_sourceInfo.empty() || m_sourceInfo.back().first < ofs) { // [1]
-            m_sourceInfo.push_back(std::make_pair(ofs,si));
-        } else {
-            SectionSourceInfo::iterator const p =
-                std::lower_bound(m_sourceInfo.begin(),m_sourceInfo.end(),ofs,&BrigSectionImpl::xless);
-            assert(p!=m_sourceInfo.end()); // because of the [1] check
-            if (p->first!=ofs) {
-                m_sourceInfo.insert(p,std::make_pair(ofs,si));
-            } else {
-                p->second=si;
-            }
+        if (m_annotate) {
+            m_sourceInfo.add(i.brigOffset(),si);
         }
     }
-
-private:
-    // commented out because typename Item::Kind is not defined at this point TBD
-    // static void assert_kind(typename Item::Kind *) {}
-    // just to make sure we are operating on appropriate type
-
-    static bool xless(const SectionSourceInfo::value_type& v,Offset o) {
-        return v.first < o;
-    }
 };
 
 SRef brigSectionNameById(int id);
@@ -423,15 +656,43 @@ class DataSection : public BrigSectionImpl
         ID = BRIG_SECTION_INDEX_DATA
     };
 
-    std::vector< Offset > m_stringSet; // ordered by strings they point to
+    /// hash and equality of the strings referenced by offsets. Offset 0
+    /// never refers to a string and stands for the key being looked up.
+    struct StringHash {
+        const DataSection* m_section;
+        explicit StringHash(const DataSection* section) : m_section(section) {}
+        size_t operator()(Offset o) const {
+            SRef const s = m_section->keyString(o);
+            return hashBytes(s.begin, s.length());
+        }
+    };
+    struct StringEq {
+        const DataSection* m_section;
+        explicit StringEq(const DataSection* section) : m_section(section) {}
+        bool operator()(Offset a, Offset b) const {
+            return m_section->keyString(a) == m_section->keyString(b);
+        }
+    };
+    typedef std::unordered_set<Offset, StringHash, StringEq> StringSet;
+
+    StringSet m_stringSet; // indexed by contents of strings they point to
+    std::vector<Offset> m_unshared; // ascending offsets of addUnshared data
+    SRef      m_lookupKey;
+    size_t    m_dedupHits; // number of addString calls that reused data
+
+    SRef keyString(Offset o) const { return o != 0 ? getString(o) : m_lookupKey; }
     void initStringSet();
 
 public:
     DataSection(class BrigContainer *container=NULL)
-      : BrigSectionImpl(brigSectionNameById(ID), container) {}
+      : BrigSectionImpl(brigSectionNameById(ID), container)
+      , m_stringSet(0, StringHash(this), StringEq(this))
+      , m_dedupHits(0) {}
 
     DataSection(const void* ptr, class BrigContainer *container=NULL)
         : BrigSectionImpl(ptr,container)
+        , m_stringSet(0, StringHash(this), StringEq(this))
+        , m_dedupHits(0)
     {
     }
 
@@ -440,6 +701,10 @@ public:
     // add without deduplication
     Offset addStringImpl(const SRef& newStr);
 
+    /// add data that may be modified in place later. It is never
+    /// returned by addString for equal contents.
+    Offset addUnshared(const SRef& newStr);
+
     SRef getString(Offset offset) const {
         assert(offset);
         const BrigData* s = getData<const BrigData>(offset);
@@ -450,16 +715,36 @@ public:
     virtual void clear() {
         BrigSectionImpl::clear();
         m_stringSet.clear();
+        m_unshared.clear();
+        m_dedupHits = 0;
+    }
+
+    /// number of addString calls that returned already present data.
+    size_t dedupHits() const { return m_dedupHits; }
+
+    /// number of entries in the index used for deduplication.
+    size_t indexCount() const { return m_stringSet.size(); }
+
+    /// approximate number of bytes used by the index.
+    size_t indexByteCount() const {
+        // node holds the next pointer, the offset and the cached hash
+        return m_stringSet.bucket_count() * sizeof(void*) +
+               m_stringSet.size() * (sizeof(void*) + sizeof(Offset) + sizeof(size_t));
     }
 
     void swapData(DataSection& other) {
         BrigSectionImpl::swapData(other);
-        m_stringSet.swap(other.m_stringSet);
+        // hash functors are bound to their section, so the indices are
+        // rebuilt lazily instead of being swapped
+        m_stringSet.clear();
+        other.m_stringSet.clear();
+        m_unshared.swap(other.m_unshared);
     }
 
     virtual void swapInData(Buffer& src) {
         BrigSectionImpl::swapInData(src);
         m_stringSet.clear();
+        m_unshared.clear();
     }
 
     DataSectionIterator begin() const;
@@ -523,6 +808,39 @@ class BrigContainerSectionByIndex<BRIG_SECTION_INDEX_OPERAND> {
 
 class ReadAdapter;
 class WriteAdapter;
+struct BrigModuleImage;
+
+/// memory used by a container, see BrigContainer::getMemoryStats.
+struct BrigMemoryStats
+{
+    struct Section {
+        std::string name;
+        size_t      byteCount;       // size of section data
+        size_t      capacity;        // bytes allocated for section data, 0 if the data is shared
+        size_t      sourceInfoCount; // number of items with source info
+        size_t      sourceInfoBytes; // bytes used by source info
+    };
+    std::vector<Section> sections;
+
+    size_t stringBytes;      // bytes of strings in data section
+    size_t listBytes;        // bytes of operand and code lists in data section
+    size_t stringIndexCount; // entries in the data section deduplication index
+    size_t stringIndexBytes; // approximate bytes used by the index
+    size_t dedupHits;        // data section additions that reused present data
+    size_t moduleBytes;      // bytes of Brig module owned by the container (mapped files are not counted)
+
+    BrigMemoryStats()
+        : stringBytes(0), listBytes(0), stringIndexCount(0), stringIndexBytes(0)
+        , dedupHits(0), moduleBytes(0) {}
+
+    /// total bytes of memory allocated by the container.
+    size_t total() const;
+
+    /// bytes allocated for section data but not used yet.
+    size_t slack() const;
+};
+
+std::ostream& operator<<(std::ostream& os, const BrigMemoryStats& stats);
 
 /// container for Brig sections. This is a basically a set of sections that
 /// comprise Brig.
@@ -530,10 +848,31 @@ class BrigContainer {
     // INSTANCE DATA
 private:
     typedef std::vector< std::unique_ptr<BrigSectionImpl> > SectionVector;
-    SectionVector m_sections;
+    mutable SectionVector m_sections; // null until loaded for lazily loaded containers
 
     const BrigModuleHeader* m_brigModuleHeader;
     std::vector<char> m_brigModuleBuffer;
+    std::shared_ptr<const char> m_brigModuleStorage; // e.g. mapped file
+    size_t m_brigModuleStorageBytes; // bytes of m_brigModuleStorage allocated by makeRO, 0 otherwise
+
+    // content hash recorded in the Brig module loaded, 0 if none
+    uint64_t m_recordedHash;
+
+    // Brig module sections not loaded yet are read from, see setLazyContents
+    std::shared_ptr<ReadAdapter>      m_lazySource;
+    std::vector<uint64_t>             m_lazySectionOffsets;
+    std::vector<std::string>          m_lazySectionNames; // read once by setLazyContents
+    std::unique_ptr<std::once_flag[]> m_lazyOnce; // per lazy section, null if not lazy
+    mutable std::atomic<int>          m_lazyPending; // lazy sections not loaded yet
+    mutable std::atomic<bool>         m_lazyLoadFailed;
+
+    bool isLazySection(int index) const {
+        return m_lazyOnce && index < (int)m_lazySectionOffsets.size();
+    }
+    void loadLazySection(int index) const;
+    void readLazySection(int index) const;
+    void resetLazyState();
+    void dropLazySections();
 
     void initSections(const BrigModuleHeader& brigModule,
                       BrigContainer::SectionVector& secs);
@@ -543,7 +882,7 @@ public:
 
     bool isROContainer() const { return m_brigModuleHeader!=nullptr; }
     bool isRWContainer() const { return !isROContainer(); }
-    bool hasOwnBuffer() const { return !m_brigModuleBuffer.empty(); }
+    bool hasOwnBuffer() const { return !m_brigModuleBuffer.empty() || m_brigModuleStorage; }
 
     BrigContainer(); // RW container
 
@@ -569,11 +908,13 @@ public:
 
     template<typename Sec>
     Sec& brigSectionById(int id) {
+      if (isLazySection(id)) loadLazySection(id);
       return static_cast<Sec&>(*m_sections[id]);
     }
 
     template<typename Sec>
     const Sec& brigSectionById(int id) const {
+      if (isLazySection(id)) loadLazySection(id);
       return static_cast<const Sec&>(*m_sections[id]);
     }
 
@@ -587,6 +928,11 @@ public:
 
     int addSection(std::unique_ptr<BrigSectionImpl>&&);
 
+    /// pre-size sections for assembling HSAIL text of numBytes bytes. Only
+    /// address space is reserved, where the target cannot do that this is
+    /// a no-op.
+    void reserveForSourceSize(size_t numBytes);
+
     int brigSectionIdByName(SRef name) const;
 
     // Append a default-initialized item (i.e. an instruction, operand, directive or debug info) to
@@ -601,7 +947,7 @@ public:
     }
 
     template<typename Item>
-    const SourceInfo* sourceInfo( const Item& i ) const {
+    SourceInfo sourceInfo( const Item& i ) const {
         return sectionById(Item::SECTION).sourceInfo(i);
     }
 
@@ -609,13 +955,37 @@ public:
     SRef getString(Offset offset) const { return strings().getString(offset); }
 
     void patchDecl2Defs();
-    //void optimizeOperands();
+
+    /// collect statistics on memory used by the container.
+    void getMemoryStats(BrigMemoryStats& stats);
+
+    /// hash of the section contents, which write records in
+    /// BrigModuleHeader::hash (as 8 little-endian bytes, the rest being 0).
+    /// The recorded hash is returned for RO containers, other containers
+    /// are hashed on each call.
+    uint64_t contentHash() const;
+
+    /// check that the hash recorded in the Brig module loaded matches its
+    /// contents. Modules without a recorded hash pass the check.
+    bool verifyContentHash(std::ostream& errs) const;
+
+    /// merge identical operands and remove the duplicates from the operand
+    /// section, patching all references to them.
+    /// @return number of bytes the operand section shrunk by.
+    size_t optimizeOperands();
 
     void clear() {
+        dropLazySections();
         strings().clear();
         code().clear();
         operands().clear();
         m_sections.resize(BRIG_SECTION_INDEX_IMPLEMENTATION_DEFINED);
+        // no section refers to the Brig module anymore
+        std::vector<char>().swap(m_brigModuleBuffer);
+        m_brigModuleStorage.reset();
+        m_brigModuleStorageBytes = 0;
+        m_recordedHash = 0;
+        m_lazyLoadFailed = false;
     }
 
     static int verifySection(int index, SRef data, std::ostream &errs);
@@ -626,8 +996,41 @@ public:
 
     bool makeRO();
 
+    /// make RO container writable, copying its sections so that items can
+    /// be modified in place through any proxy.
+    void makeRW();
+
+    /// make RO container writable without copying its contents. Sections
+    /// keep referring to the Brig module until they are modified, so only
+    /// modified sections are copied. Section modificators and writes
+    /// through item proxies (field accessors, StrRef, ItemRef, ListRef)
+    /// copy the section first. Writes through raw pointers such as
+    /// ItemBase::brig() must be preceded by BrigSectionImpl::makeWritable,
+    /// otherwise they reach the shared module, or fault on a read-only
+    /// mapping.
+    void makeCopyOnWrite();
+
     void setContents(std::vector<char>& buf);
 
+    /// make this an RO container over the Brig module at storage without
+    /// copying it. The container shares ownership of the storage.
+    void setContents(const std::shared_ptr<const char>& storage);
+
+    /// make this a RW container over the Brig module read by src whose
+    /// sections are at sectionOffsets. Each section is read and verified on
+    /// first access through sectionById; section names are read at once.
+    /// Concurrent first accesses of a section, e.g. through a container
+    /// shared by const reference, load it once. The container keeps src
+    /// until all sections are loaded or the container is cleared.
+    void setLazyContents(const std::shared_ptr<ReadAdapter>& src,
+                         const BrigModuleHeader& hdr,
+                         const std::vector<uint64_t>& sectionOffsets);
+
+    /// true if a section set by setLazyContents could not be read or
+    /// verified on first access. The section is left empty, so anything
+    /// computed from the container since then must be discarded.
+    bool lazyLoadFailed() const { return m_lazyLoadFailed.load(); }
+
     const BrigModuleHeader* getBrigModuleHeader() const {
         assert(isROContainer());
         return m_brigModuleHeader;
@@ -641,10 +1044,32 @@ public:
 
     void setData(const void *data, size_t size);
 
+    /// describe the Brig module written by write as fragments referring
+    /// to the section data, without copying it. The image stays valid as
+    /// long as the sections are not modified.
+    void getModuleImage(BrigModuleImage& image) const;
+
     bool write(WriteAdapter& w) const;
 };
 
-bool readContainer(ReadAdapter& r, BrigContainer& c, bool writeable=false);
+/// how a Brig module read by readContainer or BrigIO::load is set up in
+/// the container. false and true stand for LOAD_READ_ONLY and LOAD_WRITABLE.
+enum BrigLoadMode {
+    /// RO container, which refers to the module in place where possible.
+    LOAD_READ_ONLY     = 0,
+    /// RW container with a copy of each section, read one at a time.
+    LOAD_WRITABLE      = 1,
+    /// RW container which refers to the module in place where possible,
+    /// see BrigContainer::makeCopyOnWrite.
+    LOAD_COPY_ON_WRITE = 2
+};
+
+/// @param mode - one of BrigLoadMode.
+bool readContainer(ReadAdapter& r, BrigContainer& c, int mode=LOAD_READ_ONLY);
+
+/// validate the Brig module read by r and set it as lazily loaded contents
+/// of c, see BrigContainer::setLazyContents.
+bool readContainerLazily(const std::shared_ptr<ReadAdapter>& r, BrigContainer& c);
 
 // non-const
 inline DataSection& BrigContainer::strings()  {
@@ -48,6 +48,10 @@
 #define LSEEK _lseeki64
 #else
 #include <unistd.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #define O_BINARY_ 0
 #define LSEEK lseek64
 #endif
@@ -253,6 +257,13 @@ IOAdapter::~IOAdapter() {
 WriteAdapter::~WriteAdapter() {
 }
 
+int WriteAdapter::writev(const Fragment* fragments, size_t numFragments) const {
+    for(size_t i = 0; i < numFragments; ++i) {
+        if (write(fragments[i].data, fragments[i].numBytes)) return 1;
+    }
+    return 0;
+}
+
 int WriteAdapter::writeAlignPad(unsigned pow2) {
     const char zeropad[] = "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0";
     size_t const p = (size_t)getPos();
@@ -270,6 +281,23 @@ ReadAdapter::~ReadAdapter() {
 ReadWriteAdapter::~ReadWriteAdapter() {
 }
 
+/// append fragment of data to be written at position at, preceded by
+/// zero padding from the current position pos.
+static void addFragment(std::vector<WriteAdapter::Fragment>& frags, uint64_t& pos,
+                        uint64_t at, const char* data, size_t numBytes) {
+    static const char zeropad[16] = { 0 };
+    assert(pos <= at && at - pos <= sizeof zeropad);
+    if (at > pos) {
+        WriteAdapter::Fragment const pad = { zeropad, (size_t)(at - pos) };
+        frags.push_back(pad);
+    }
+    if (numBytes > 0) {
+        WriteAdapter::Fragment const f = { data, numBytes };
+        frags.push_back(f);
+    }
+    pos = at + numBytes;
+}
+
 
 template<typename Policy>
 class BrigIOImpl {
@@ -285,7 +313,6 @@ class BrigIOImpl {
     std::vector<char> sectionNameTable;
     std::vector<char> symtabData;
     std::vector<char> strtabData;
-    std::vector< SRef > sectionData;
     int fmt;
 
 public:
@@ -296,32 +323,8 @@ public:
 
     // Loading code
 public:
-    int readContainer(BrigContainer &c, ReadAdapter *s) {
-        if (s->pread((char*)&elfHeader, sizeof(elfHeader), 0)) {
-            return 1;
-        }
-        if (!elfHeader.checkMagic()) {
-            s->errs << "Invalid ELF header" << std::endl;
-            return 1;
-        }
-        if (fmt == FILE_FORMAT_AUTO) {
-            if (elfHeader.e_machine == Policy::EM_HSAIL_) {
-                fmt = FILE_FORMAT_BIF;
-            } else {
-                fmt = FILE_FORMAT_BRIG;
-            }
-        }
-        sectionHeaders.resize(elfHeader.e_shnum);
-        for(int i=0; i < elfHeader.e_shnum; ++i) {
-            if (s->pread((char*)&sectionHeaders[i], sizeof(Shdr),
-                              elfHeader.e_shoff + i * elfHeader.e_shentsize))
-            {
-                return 1;
-            }
-        };
-        if (readSection(sectionNameTable, s, elfHeader.e_shstrndx)) return 1;
-        // force nul termination of string table
-        sectionNameTable.push_back(0);
+    int readContainer(BrigContainer &c, ReadAdapter *s, int mode) {
+        if (readHeaders(s)) return 1;
 
         for(int i=1; i < elfHeader.e_shnum; ++i) {
             const char* name = sectionName(i);
@@ -334,7 +337,7 @@ public:
                 const Shdr &h = sectionHeaders[i];
                 if (!HSAIL_ASM::readContainer(
                     *BrigIO::fragmentReadingAdapter(s, h.sh_size,
-                                                       h.sh_offset), c)) {
+                                                       h.sh_offset), c, mode)) {
                     return 1;
                 }
                 break;
@@ -351,8 +354,56 @@ public:
         }
         return 0;
     }
+
+    /// find the section holding Brig module.
+    /// @return 0 if found, -1 if there is no such section, 1 on error.
+    int findBrigBlob(ReadAdapter *s, uint64_t& offset, uint64_t& size) {
+        if (readHeaders(s)) return 1;
+
+        for(int i=1; i < elfHeader.e_shnum; ++i) {
+            const char* name = sectionName(i);
+            if (!name) continue;
+
+            const SectionDesc* desc = descByKey(predefinedSectionName(), name);
+            if (desc && desc->sectionId == BRIG_SECTION_INDEX_BLOB) {
+                offset = sectionHeaders[i].sh_offset;
+                size = sectionHeaders[i].sh_size;
+                return 0;
+            }
+        }
+        return -1;
+    }
 private:
 
+    int readHeaders(ReadAdapter *s) {
+        if (s->pread((char*)&elfHeader, sizeof(elfHeader), 0)) {
+            return 1;
+        }
+        if (!elfHeader.checkMagic()) {
+            s->errs << "Invalid ELF header" << std::endl;
+            return 1;
+        }
+        if (fmt == FILE_FORMAT_AUTO) {
+            if (elfHeader.e_machine == Policy::EM_HSAIL_) {
+                fmt = FILE_FORMAT_BIF;
+            } else {
+                fmt = FILE_FORMAT_BRIG;
+            }
+        }
+        sectionHeaders.resize(elfHeader.e_shnum);
+        for(int i=0; i < elfHeader.e_shnum; ++i) {
+            if (s->pread((char*)&sectionHeaders[i], sizeof(Shdr),
+                              elfHeader.e_shoff + i * elfHeader.e_shentsize))
+            {
+                return 1;
+            }
+        };
+        if (readSection(sectionNameTable, s, elfHeader.e_shstrndx)) return 1;
+        // force nul termination of string table
+        sectionNameTable.push_back(0);
+        return 0;
+    }
+
     int preadVec(ReadAdapter *s, std::vector<char> &dst, unsigned size, uint64_t ofs) const {
         dst.resize(size);
         if (0 == size) return 0;
@@ -403,32 +454,97 @@ private:
 
 public:
 
+    /// write the Brig module of c as an ELF image. The module is written
+    /// straight from the container sections: the string and symbol tables
+    /// and the file layout are computed in one pass, then everything is
+    /// written with a single writev, so no copy of the module is made.
     int writeContainer(WriteAdapter *s, const BrigContainer& c) {
         reset();
 
-        std::vector<char> buf;
-        if (!c.write(*BrigIO::vectorWritingAdapter(buf)))
-           return 1;
+        BrigModuleImage module;
+        c.getModuleImage(module);
+        if (module.byteCount() > (std::numeric_limits<ElfWord>::max)()) {
+            s->errs << "Brig module is too large for BIF" << std::endl;
+            return 1;
+        }
 
-        addSection(descById(BRIG_SECTION_INDEX_BLOB), buf, true);
+        std::vector<int> sectionIds;
+        sectionIds.push_back(BRIG_SECTION_INDEX_BLOB);
+        if (fmt == FILE_FORMAT_BIF) {
+            sectionIds.push_back(ELF_SECTION_STRTAB);
+            sectionIds.push_back(ELF_SECTION_SYMTAB);
+        }
+        sectionIds.push_back(ELF_SECTION_SHSTRTAB); // must always be the last
 
+        Shdr nullSec;
+        memset(&nullSec, 0, sizeof(nullSec));
+        sectionHeaders.assign(sectionIds.size() + 1, nullSec);
         unsigned strTabNdx = 0;
         unsigned symTabNdx = 0;
+        for(unsigned shndx = 1; shndx < sectionHeaders.size(); ++shndx) {
+            const SectionDesc& desc = descById(sectionIds[shndx - 1]);
+            Shdr &thisSec = sectionHeaders[shndx];
+            thisSec.sh_type = desc.type;
+            thisSec.sh_flags = desc.flags;
+            thisSec.sh_addralign = desc.align;
+            thisSec.sh_name = addString(&sectionNameTable, desc.*predefinedSectionName());
+            switch (desc.sectionId) {
+            case ELF_SECTION_STRTAB: strTabNdx = shndx; break;
+            case ELF_SECTION_SYMTAB: symTabNdx = shndx; break;
+            case BRIG_SECTION_INDEX_BLOB:
+                thisSec.sh_size = (ElfWord)module.byteCount();
+                if (fmt == FILE_FORMAT_BIF && desc.symbolName) {
+                    addSymbol(desc.symbolName, shndx, thisSec.sh_size);
+                }
+                break;
+            default:;
+            }
+        }
         if (fmt == FILE_FORMAT_BIF) {
-            strTabNdx = addSection(descById(ELF_SECTION_STRTAB), strtabData);
-            symTabNdx = addSection(descById(ELF_SECTION_SYMTAB), symtabData);
             sectionHeaders[symTabNdx].sh_link = strTabNdx;
             sectionHeaders[symTabNdx].sh_entsize = sizeof(Sym);
+            sectionHeaders[symTabNdx].sh_size = (ElfWord)symtabData.size();
+            sectionHeaders[strTabNdx].sh_size = (ElfWord)strtabData.size();
+        }
+        sectionHeaders.back().sh_size = (ElfWord)sectionNameTable.size();
+
+        initElfHeader();
+
+        std::vector<WriteAdapter::Fragment> frags;
+        frags.reserve(module.fragments.size() + 2 * sectionHeaders.size() + 4);
+        uint64_t pos = 0;
+        addFragment(frags, pos, 0, (const char*)&elfHeader, sizeof(Ehdr));
+        for(unsigned shndx = 1; shndx < sectionHeaders.size(); ++shndx) {
+            Shdr &shdr = sectionHeaders[shndx];
+            shdr.sh_offset = align(pos, (size_t)shdr.sh_addralign);
+            switch (sectionIds[shndx - 1]) {
+            case BRIG_SECTION_INDEX_BLOB:
+                addFragment(frags, pos, shdr.sh_offset, NULL, 0);
+                frags.insert(frags.end(), module.fragments.begin(), module.fragments.end());
+                pos += shdr.sh_size;
+                break;
+            case ELF_SECTION_STRTAB:
+                addFragment(frags, pos, shdr.sh_offset, &strtabData[0], strtabData.size());
+                break;
+            case ELF_SECTION_SYMTAB:
+                addFragment(frags, pos, shdr.sh_offset, &symtabData[0], symtabData.size());
+                break;
+            case ELF_SECTION_SHSTRTAB:
+                addFragment(frags, pos, shdr.sh_offset, &sectionNameTable[0], sectionNameTable.size());
+                break;
+            default: assert(false);
+            }
         }
-        unsigned shStrTabNdx = addSection(descById(ELF_SECTION_SHSTRTAB), sectionNameTable);
+        // the ELF header fragment refers to elfHeader, so e_shoff is written with it
+        elfHeader.e_shoff = align(pos, 4);
+        addFragment(frags, pos, elfHeader.e_shoff, (const char*)&sectionHeaders[0],
+                    sectionHeaders.size() * sizeof(Shdr));
 
-        // string/symbol tables were resized/reallocated
-        if (fmt == FILE_FORMAT_BIF) {
-          updateSection(symTabNdx, symtabData);
-          updateSection(strTabNdx, strtabData);
+        if (s->writev(&frags[0], frags.size())) {
+            s->errs << "cannot write BIF" << std::endl;
+            return 1;
         }
-        updateSection(shStrTabNdx, sectionNameTable);
-        return writeElf(s);
+        return 0;
     }
 private:
 
@@ -437,7 +553,6 @@ private:
         sectionNameTable.clear();
         symtabData.clear();
         strtabData.clear();
-        sectionData.clear();
     }
 
     unsigned addString(std::vector<char> *strtab, const std::string &str) {
@@ -450,107 +565,21 @@ private:
         return pos;
     }
 
-    int alignFilePos(WriteAdapter *s, Off &pos, unsigned align) {
-        const char zeropad[] = "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0";
-        assert(align > 0 && (0 == (align&(align-1))));
-        unsigned n = static_cast<unsigned>((~pos+1) & (align-1));
-        assert(n < sizeof zeropad);
-        if (n == 0) { return 0; }
-        if (s && s->write(zeropad, n)) {
-            return 1;
-        }
-        pos += n;
-        return 0;
-    }
-
-    void updateSection(unsigned shndx, SRef data) {
-        sectionData[shndx] = data;
-        sectionHeaders[shndx].sh_size = (ElfWord)data.length();
-        for(size_t pos = sizeof(Sym); pos < symtabData.size(); pos += sizeof(Sym)) {
-          Sym *pSym = (Sym*)(&symtabData[pos]);
-          if (pSym->st_shndx == shndx) {
-            pSym->st_size = (ElfWord)data.length();
-            break;
-          }
-        }
-    }
-
-    unsigned addSection(const SectionDesc& desc, SRef data) {
-        bool const includesHeader =
-            desc.sectionId >= 0 &&
-            desc.sectionId < BRIG_SECTION_INDEX_IMPLEMENTATION_DEFINED;
-        return addSection(desc, data, includesHeader);
-    }
-
-    unsigned addSection(const SectionDesc& desc, SRef data, bool includesHeader) {
-        Shdr thisSec;
-        memset(&thisSec, 0, sizeof(thisSec));
-        if (sectionHeaders.empty()) {
-            sectionHeaders.push_back(thisSec);
-            sectionData.push_back("");
-        }
-        assert(data.length() < INT_MAX);
-        if (!includesHeader) {
-            BrigSectionHeader *header = (BrigSectionHeader*)data.begin;
-            data.begin += header->headerByteCount;
-        }
-        unsigned shndx = (unsigned)sectionHeaders.size();
-        thisSec.sh_type = desc.type;
-        thisSec.sh_flags = desc.flags;
-        thisSec.sh_addralign = desc.align;
-        thisSec.sh_name = addString(&sectionNameTable, desc.*predefinedSectionName());
-        thisSec.sh_size = (ElfWord)data.length();
-        const char* symbolName = desc.symbolName;
-        if (fmt == FILE_FORMAT_BIF && symbolName) {
-            Sym sym;
-            memset(&sym, 0, sizeof(sym));
-            if (symtabData.empty()) {
-                symtabData.insert(symtabData.end(), (char*)(&sym), (char*)(&sym+1));
-            }
-            sym.st_name = addString(&strtabData, symbolName);
-            sym.st_value = 0; // Value or address associated with the symbol
-            sym.st_size = (ElfWord)data.length(); // Size of the symbol
-            sym.st_shndx = shndx; // Section's index
-            sym.st_info = (STB_LOCAL << 4) | STT_OBJECT;
+    void addSymbol(const char* symbolName, unsigned shndx, uint64_t size) {
+        Sym sym;
+        memset(&sym, 0, sizeof(sym));
+        if (symtabData.empty()) {
             symtabData.insert(symtabData.end(), (char*)(&sym), (char*)(&sym+1));
         }
-        sectionHeaders.push_back(thisSec);
-        sectionData.push_back(data);
-        return shndx;
-    }
-
-    int writeContents(WriteAdapter *s) {
-        Off filePos = sizeof(Ehdr);
-        if (s && s->write((char*)&elfHeader, sizeof(Ehdr))) {
-            return 1;
-        }
-        if (alignFilePos(s, filePos, 4)) {
-            return 1;
-        }
-        for(unsigned secIndex = 1; secIndex < sectionHeaders.size(); ++secIndex) {
-            Shdr &shdr = sectionHeaders[secIndex];
-            if (alignFilePos(s, filePos, static_cast<unsigned>(shdr.sh_addralign))) {
-                return 1;
-            }
-            shdr.sh_offset = filePos;
-            if (s && s->write(sectionData[secIndex].begin, 
-                              static_cast<unsigned>(shdr.sh_size))) {
-                return 1;
-            }
-            filePos += shdr.sh_size;
-        }
-
-        if (alignFilePos(s, filePos, 4)) {
-            return 1;
-        }
-        elfHeader.e_shoff = filePos;
-        if (s && s->write((char*)&sectionHeaders[0], elfHeader.e_shnum * elfHeader.e_shentsize)) {
-            return 1;
-        }
-        return 0;
+        sym.st_name = addString(&strtabData, symbolName);
+        sym.st_value = 0; // Value or address associated with the symbol
+        sym.st_size = (ElfWord)size; // Size of the symbol
+        sym.st_shndx = shndx; // Section's index
+        sym.st_info = (STB_LOCAL << 4) | STT_OBJECT;
+        symtabData.insert(symtabData.end(), (char*)(&sym), (char*)(&sym+1));
     }
 
-    int writeElf(WriteAdapter *s) {
+    void initElfHeader() {
         memset(&elfHeader, 0, sizeof(elfHeader));
         memcpy(elfHeader.e_ident, ElfMagic, 4);
         elfHeader.e_ident[EI_CLASS] = Policy::ELFCLASS;
@@ -567,11 +596,7 @@ private:
         elfHeader.e_shentsize = sizeof(Shdr);
         elfHeader.e_shnum = ElfHalf(sectionHeaders.size());
         elfHeader.e_shstrndx = elfHeader.e_shnum - 1; // must always be the last
-
-        // dry run to calculate section offsets, then
-        return writeContents(0)
-            || writeContents(s);
-    };
+    }
 };
 
 
@@ -654,6 +679,7 @@ struct FileAdapter : public ReadWriteAdapter {
 };
 #else
 struct FileAdapter : public ReadWriteAdapter {
+    enum { WRITE_BUFFER_SIZE = 1 << 20 };
     mutable FILE* fd;
     FileAdapter(std::ostream& errs_)
         : IOAdapter(errs_)
@@ -671,6 +697,10 @@ struct FileAdapter : public ReadWriteAdapter {
             errs << " opening \"" << filename << "\"" << std::endl;
             return 1;
         }
+        if (forWriting) {
+            // small writes of headers and padding are coalesced
+            setvbuf(fd, NULL, _IOFBF, WRITE_BUFFER_SIZE);
+        }
         return 0;
     }
     int check1(int val) const {
@@ -715,6 +745,47 @@ struct FileAdapter : public ReadWriteAdapter {
         }
         return 0;
     }
+#ifndef _WIN32
+    virtual int writev(const Fragment* fragments, size_t numFragments) const {
+        if (check1(fflush(fd))) {
+            errs << " writing" << std::endl;
+            return 1;
+        }
+        off_t pos = ftello(fd);
+        std::vector<struct iovec> iov;
+        iov.reserve(numFragments);
+        for(size_t i = 0; i < numFragments; ++i) {
+            if (fragments[i].numBytes > 0) {
+                struct iovec const v = { const_cast<char*>(fragments[i].data), fragments[i].numBytes };
+                iov.push_back(v);
+            }
+        }
+        for(size_t i = 0; i < iov.size(); ) {
+            ssize_t res = ::writev(fileno(fd), &iov[i], (int)(std::min)(iov.size() - i, (size_t)IOV_MAX));
+            if (res < 0 && errno == EINTR) continue;
+            if (check1(res < 0 ? -1 : 0)) {
+                errs << " writing" << std::endl;
+                return 1;
+            }
+            if (res == 0) {
+                // no progress with bytes still pending, retrying would spin
+                errs << "Wrote 0 bytes of " << iov[i].iov_len << " pending" << std::endl;
+                return 1;
+            }
+            pos += res;
+            // skip what has been written, partial writes are continued
+            for(; i < iov.size() && (size_t)res >= iov[i].iov_len; ++i) {
+                res -= iov[i].iov_len;
+            }
+            if (res > 0) {
+                iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + res;
+                iov[i].iov_len -= res;
+            }
+        }
+        // keep the stream position in sync with the file
+        return check1(fseeko(fd, pos, SEEK_SET));
+    }
+#endif
     virtual int pread(char* data, size_t numBytes, uint64_t offset) const {
         if (check1(fseek(fd, (long)offset, SEEK_SET))) return 1;
         size_t const rc = fread(data, 1, numBytes, fd);
@@ -736,6 +807,86 @@ struct FileAdapter : public ReadWriteAdapter {
 };
 #endif
 
+// MAPPED FILE ADAPTER
+
+#ifndef _WIN32
+/// read-only adapter over a file mapped into memory. The mapping is read-only,
+/// so a raw write to a section still referring to it (see
+/// BrigContainer::makeCopyOnWrite) faults instead of changing the data seen by
+/// other containers sharing the mapping. Note that the file must not be
+/// truncated while it is mapped.
+struct MappedFileAdapter : public ReadAdapter {
+    std::shared_ptr<const char> mapping;
+    size_t                      size;
+    Position                    pos;
+
+    MappedFileAdapter(std::ostream& errs_)
+        : IOAdapter(errs_)
+        , ReadAdapter(errs_)
+        , size(0)
+        , pos(0)
+    {
+    }
+    static void printErr(std::ostream& s) {
+        s << "Error " << errno << " (" << strerror(errno) << ")";
+    }
+    struct Unmap {
+        size_t size;
+        explicit Unmap(size_t size_) : size(size_) {}
+        void operator()(const char* p) const { ::munmap(const_cast<char*>(p), size); }
+    };
+    /// returns 0 on success, 1 if the file cannot be opened and
+    /// -1 if it cannot be mapped (e.g. it is empty or not a regular file).
+    int open(const char* filename) {
+        int const fd = ::open(filename, O_RDONLY | O_BINARY_);
+        if (fd < 0) {
+            printErr(errs);
+            errs << " opening \"" << filename << "\"" << std::endl;
+            return 1;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+            (uint64_t)st.st_size > (std::numeric_limits<size_t>::max)()) {
+            ::close(fd);
+            return -1;
+        }
+        size_t const fileSize = (size_t)st.st_size;
+        void* const p = ::mmap(0, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            return -1;
+        }
+        mapping = std::shared_ptr<const char>((const char*)p, Unmap(fileSize));
+        size = fileSize;
+        return 0;
+    }
+    virtual Position getSize() const {
+        return size;
+    }
+    virtual Position getPos() const {
+        return pos;
+    }
+    virtual void setPos(Position p) {
+        pos = p;
+    }
+    virtual int pread(char* data, size_t numBytes, uint64_t offset) const {
+        if (offset > size || numBytes > size - offset) {
+            errs << "Reading beyond the end of the file" << std::endl;
+            return 1;
+        }
+        if (numBytes == 0) return 0;
+        memcpy(data, mapping.get() + offset, numBytes);
+        return 0;
+    }
+    virtual std::shared_ptr<const char> sharedData() const {
+        return mapping;
+    }
+    virtual const char* contents() const {
+        return mapping.get();
+    }
+};
+#endif
+
 struct FragmentReadAdapter : ReadAdapter {
     ReadAdapter& r;
     Position const size;
@@ -757,7 +908,7 @@ struct FragmentReadAdapter : ReadAdapter {
     }
 
     virtual int pread(char* data, size_t numBytes, uint64_t ofs) const {
-        if (numBytes > size) {
+        if (ofs > size || numBytes > size - ofs) {
             errs << "reading beyond fragment end" << std::endl;
             return 1;
         }
@@ -765,6 +916,16 @@ struct FragmentReadAdapter : ReadAdapter {
     }
 
     virtual Position getSize() const { return size; };
+
+    virtual std::shared_ptr<const char> sharedData() const {
+        std::shared_ptr<const char> const data = r.sharedData();
+        return data ? std::shared_ptr<const char>(data, data.get() + offset) : data;
+    }
+
+    virtual const char* contents() const {
+        const char* const data = r.contents();
+        return data ? data + offset : data;
+    }
 };
 
 struct VectorAdapter : public ReadWriteAdapter {
@@ -795,6 +956,16 @@ struct VectorAdapter : public ReadWriteAdapter {
         pos += numBytes;
         return 0;
     }
+    virtual int writev(const Fragment* fragments, size_t numFragments) const {
+        size_t newSize = pos;
+        for(size_t i = 0; i < numFragments; ++i) {
+            newSize += fragments[i].numBytes;
+        }
+        if (newSize > buf.size()) {
+            buf.resize(newSize);
+        }
+        return WriteAdapter::writev(fragments, numFragments);
+    }
     virtual int pread(char* data, size_t numBytes, uint64_t offset) const {
         if (offset + numBytes > buf.size()) {
             errs << "Reading beyond the end of the buffer" << std::endl;
@@ -804,6 +975,9 @@ struct VectorAdapter : public ReadWriteAdapter {
         memcpy(data, &buf[static_cast<size_t>(offset)], numBytes);
         return 0;
     }
+    virtual const char* contents() const {
+        return buf.empty() ? NULL : &buf[0];
+    }
     ~VectorAdapter() {
     }
 };
@@ -850,6 +1024,9 @@ struct MemoryAdapter : public ReadWriteAdapter {
         memcpy(data, buf + offset, numBytes);
         return 0;
     }
+    virtual const char* contents() const {
+        return buf;
+    }
     ~MemoryAdapter() {
     }
 };
@@ -907,6 +1084,23 @@ std::unique_ptr<ReadAdapter> BrigIO::fileReadingAdapter(
     return std::move(theFile);
 }
 
+std::unique_ptr<ReadAdapter> BrigIO::mappedFileReadingAdapter(
+                const char* fileName,
+                std::ostream& errs)
+{
+#ifndef _WIN32
+    std::unique_ptr<MappedFileAdapter> theFile( new MappedFileAdapter(errs) );
+    int const rc = theFile->open(fileName);
+    if (rc == 0) {
+        return std::move(theFile);
+    }
+    if (rc > 0) {
+        return std::unique_ptr<ReadAdapter>();
+    }
+#endif
+    return fileReadingAdapter(fileName, errs);
+}
+
 std::unique_ptr<WriteAdapter> BrigIO::fileWritingAdapter(
                 const char* fileName,
                 std::ostream& errs)
@@ -960,26 +1154,187 @@ std::unique_ptr<ReadAdapter> BrigIO::fragmentReadingAdapter(
 }
 
 
+// COMPRESSED BRIG
+
+// A compressed Brig module starts with BrigCompressedHeader followed by
+// the sizes of its blocks and the blocks. Each block holds blockSize bytes
+// of the module (the last one possibly less) compressed by lzCompress, or
+// stored as is if it does not compress.
+
+struct BrigCompressedHeader {
+    char     identification[8]; // "HSA BRGZ"
+    uint32_t version;
+    uint32_t blockSize;
+    uint64_t byteCount;         // of the module
+    uint64_t blockCount;
+};
+
+static const char     BRIG_COMPRESSED_IDENT[] = "HSA BRGZ";
+static const uint32_t BRIG_COMPRESSED_VERSION = 1;
+static const uint32_t BRIG_COMPRESSED_BLOCK_SIZE = 256 * 1024;
+static const uint32_t BRIG_COMPRESSED_MAX_BLOCK_SIZE = 64 * 1024 * 1024;
+static const uint32_t BRIG_BLOCK_STORED = 0x80000000; // flags stored block sizes
+
+static int writeCompressed(BrigContainer& c, WriteAdapter& dst) {
+    std::vector<char> module;
+    const char* data;
+    uint64_t size;
+    if (c.isROContainer()) {
+        data = (const char*)c.getBrigModuleHeader();
+        size = c.getBrigModuleHeader()->byteCount;
+    } else {
+        if (!c.write(*BrigIO::vectorWritingAdapter(module, dst.errs))) return 1;
+        data = &module[0];
+        size = module.size();
+    }
+
+    BrigCompressedHeader hdr;
+    memcpy(hdr.identification, BRIG_COMPRESSED_IDENT, sizeof hdr.identification);
+    hdr.version = BRIG_COMPRESSED_VERSION;
+    hdr.blockSize = BRIG_COMPRESSED_BLOCK_SIZE;
+    hdr.byteCount = size;
+    hdr.blockCount = (size + hdr.blockSize - 1) / hdr.blockSize;
+
+    std::vector<uint32_t> blockSizes((size_t)hdr.blockCount);
+    std::vector<char> blocks;
+    blocks.reserve(lzCompressBound((size_t)size) + 16 * blockSizes.size());
+    for(size_t i = 0; i < blockSizes.size(); ++i) {
+        uint64_t const offset = (uint64_t)i * hdr.blockSize;
+        size_t const n = (size_t)(std::min)((uint64_t)hdr.blockSize, size - offset);
+        size_t const pos = blocks.size();
+        blocks.resize(pos + lzCompressBound(n));
+        size_t const compressed = lzCompress(data + offset, n, &blocks[pos]);
+        if (compressed < n) {
+            blockSizes[i] = (uint32_t)compressed;
+            blocks.resize(pos + compressed);
+        } else {
+            blockSizes[i] = (uint32_t)n | BRIG_BLOCK_STORED;
+            memcpy(&blocks[pos], data + offset, n);
+            blocks.resize(pos + n);
+        }
+    }
+
+    WriteAdapter::Fragment const frags[] = {
+        { (const char*)&hdr, sizeof hdr },
+        { (const char*)blockSizes.data(), blockSizes.size() * sizeof(uint32_t) },
+        { blocks.data(), blocks.size() }
+    };
+    if (dst.writev(frags, sizeof frags / sizeof frags[0])) {
+        dst.errs << "cannot write compressed Brig module" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+static int readCompressed(ReadAdapter& src, BrigContainer& c, int mode) {
+    BrigCompressedHeader hdr;
+    if (src.pread((char*)&hdr, sizeof hdr, 0)) return 1;
+    IOAdapter::Position const srcSize = src.getSize();
+    bool const sizeKnown = srcSize != (IOAdapter::Position)-1;
+    if (hdr.version != BRIG_COMPRESSED_VERSION ||
+        hdr.blockSize == 0 || hdr.blockSize > BRIG_COMPRESSED_MAX_BLOCK_SIZE ||
+        hdr.byteCount >= (std::numeric_limits<size_t>::max)() ||
+        hdr.blockCount != (hdr.byteCount + hdr.blockSize - 1) / hdr.blockSize ||
+        (sizeKnown && (srcSize < sizeof hdr ||
+                       hdr.blockCount > (srcSize - sizeof hdr) / sizeof(uint32_t)))) {
+        src.errs << "Invalid compressed Brig header" << std::endl;
+        return 1;
+    }
+
+    // the block table is read in chunks, so that it grows only as far as
+    // the input actually extends when the size of the input is unknown
+    std::vector<uint32_t> blockSizes;
+    uint64_t pos = sizeof hdr;
+    while (blockSizes.size() < hdr.blockCount) {
+        size_t const n = (size_t)(std::min)(hdr.blockCount - blockSizes.size(), (uint64_t)64 * 1024);
+        size_t const first = blockSizes.size();
+        blockSizes.resize(first + n);
+        if (src.pread((char*)&blockSizes[first], n * sizeof(uint32_t), pos)) return 1;
+        pos += n * sizeof(uint32_t);
+    }
+
+    // validate the block table before the module is allocated: each block
+    // must fit the input and account for its share of byteCount
+    uint64_t end = pos;
+    for(size_t i = 0; i < blockSizes.size(); ++i) {
+        uint64_t const offset = (uint64_t)i * hdr.blockSize;
+        uint64_t const n = (std::min)((uint64_t)hdr.blockSize, hdr.byteCount - offset);
+        uint64_t const numBytes = blockSizes[i] & ~BRIG_BLOCK_STORED;
+        bool const ok = (blockSizes[i] & BRIG_BLOCK_STORED)
+            ? numBytes == n
+            : numBytes < n && n <= lzDecompressBound(numBytes);
+        end += numBytes;
+        if (!ok || (sizeKnown && end > srcSize)) {
+            src.errs << "Corrupted compressed Brig block #" << i << std::endl;
+            return 1;
+        }
+    }
+
+    // blocks of adapters keeping data in memory are decompressed in place.
+    // Without a known input size the module grows block by block, so a
+    // corrupted table fails before its sizes are allocated.
+    std::shared_ptr<const char> const shared = src.sharedData();
+    std::vector<char> buf;
+    if (sizeKnown) buf.reserve((size_t)hdr.byteCount);
+    std::vector<char> block;
+    for(size_t i = 0; i < blockSizes.size(); ++i) {
+        size_t const offset = buf.size();
+        size_t const n = (size_t)(std::min)((uint64_t)hdr.blockSize, hdr.byteCount - offset);
+        size_t const numBytes = blockSizes[i] & ~BRIG_BLOCK_STORED;
+        buf.resize(offset + n);
+        bool ok;
+        if (blockSizes[i] & BRIG_BLOCK_STORED) {
+            ok = src.pread(&buf[offset], n, pos) == 0;
+        } else if (shared && sizeKnown) {
+            ok = lzDecompress(shared.get() + pos, numBytes, &buf[offset], n);
+        } else {
+            block.resize(numBytes);
+            ok = src.pread(block.data(), numBytes, pos) == 0 &&
+                 lzDecompress(block.data(), numBytes, &buf[offset], n);
+        }
+        if (!ok) {
+            src.errs << "Corrupted compressed Brig block #" << i << std::endl;
+            return 1;
+        }
+        pos += numBytes;
+    }
+
+    if (buf.empty() ||
+        BrigIO::validateBrigBlob(*BrigIO::memoryReadingAdapter(&buf[0], buf.size(), src.errs))) {
+        return 1;
+    }
+    c.setContents(buf);
+    if (mode != LOAD_READ_ONLY) {
+        // the decompressed module is owned by the container alone, so
+        // sections are copied only when they are modified
+        c.makeCopyOnWrite();
+    }
+    return 0;
+}
+
 int BrigIO::load(BrigContainer &dst,
                  int           fmt,
                  ReadAdapter&  src,
-                 bool writable)
+                 int           mode)
 {
     unsigned char ident[16];
     if (0 != src.pread((char*)ident, 16, 0)) {
         return 1;
     }
     if (memcmp("HSA BRIG", ident, 8)==0) {
-        return HSAIL_ASM::readContainer(src, dst, writable) ? 0 : 1;
+        return HSAIL_ASM::readContainer(src, dst, mode) ? 0 : 1;
+    }
+    if (memcmp(BRIG_COMPRESSED_IDENT, ident, 8)==0) {
+        return readCompressed(src, dst, mode);
     }
     switch(ident[EI_CLASS]) {
     case Elf32Policy::ELFCLASS: {
         BrigIOImpl<Elf32Policy> impl(fmt);
-        return impl.readContainer(dst, &src);
+        return impl.readContainer(dst, &src, mode);
         }
     case Elf64Policy::ELFCLASS: {
         BrigIOImpl<Elf64Policy> impl(fmt);
-        return impl.readContainer(dst, &src);
+        return impl.readContainer(dst, &src, mode);
         }
     default:
         src.errs << "Unsupported file format" << std::endl;
@@ -987,10 +1342,67 @@ int BrigIO::load(BrigContainer &dst,
     }
 }
 
+int BrigIO::loadLazily(BrigContainer&               dst,
+                       int                          fmt,
+                       std::shared_ptr<ReadAdapter> src)
+{
+    if (!src) return 1;
+    // modules which can be used in place need not be read at all, and
+    // only the sections modified later are copied
+    if (src->sharedData()) {
+        return load(dst, fmt, *src, LOAD_COPY_ON_WRITE);
+    }
+    unsigned char ident[16];
+    if (0 != src->pread((char*)ident, 16, 0)) {
+        return 1;
+    }
+    if (memcmp("HSA BRIG", ident, 8)==0) {
+        return HSAIL_ASM::readContainerLazily(src, dst) ? 0 : 1;
+    }
+    if (memcmp(BRIG_COMPRESSED_IDENT, ident, 8)==0) {
+        // the whole module is decompressed at once
+        return load(dst, fmt, *src, LOAD_WRITABLE);
+    }
+    uint64_t offset = 0, size = 0;
+    int res;
+    switch(ident[EI_CLASS]) {
+    case Elf32Policy::ELFCLASS: {
+        BrigIOImpl<Elf32Policy> impl(fmt);
+        res = impl.findBrigBlob(src.get(), offset, size);
+        break;
+        }
+    case Elf64Policy::ELFCLASS: {
+        BrigIOImpl<Elf64Policy> impl(fmt);
+        res = impl.findBrigBlob(src.get(), offset, size);
+        break;
+        }
+    default:
+        src->errs << "Unsupported file format" << std::endl;
+        return 1;
+    }
+    if (res < 0) {
+        // sections are stored separately, load them at once
+        return load(dst, fmt, *src, LOAD_WRITABLE);
+    }
+    if (res > 0) return 1;
+    // the fragment keeps the file adapter it reads from
+    std::shared_ptr<ReadAdapter> const blob(
+        fragmentReadingAdapter(src.get(), size, offset).release(),
+        [src](ReadAdapter* a) { delete a; });
+    return HSAIL_ASM::readContainerLazily(blob, dst) ? 0 : 1;
+}
+
 int BrigIO::save(BrigContainer &src,
                  int           fmt,
                  WriteAdapter& dst)
 {
+    if (fmt & FILE_FORMAT_COMPRESSED) {
+        if ((fmt & FILE_FORMAT_MASK) != FILE_FORMAT_BRIG) {
+            dst.errs << "Compression is supported for BRIG format only" << std::endl;
+            return 1;
+        }
+        return writeCompressed(src, dst);
+    }
     switch (fmt & FILE_FORMAT_MASK) {
     case FILE_FORMAT_BRIG:
         return src.write(dst) ? 0 : 1;
@@ -1029,6 +1441,11 @@ protected:
     { 
         return fd.pread(dst, (size_t) numBytes, offset) == 0;
     };
+
+    virtual const char* contents() const
+    {
+        return fd.contents();
+    }
 };
 
 int BrigIO::validateBrigBlob(ReadAdapter& fd)
@@ -1040,6 +1457,324 @@ int BrigIO::validateBrigBlob(ReadAdapter& fd)
     return 1; 
 }
 
+// --------------------------------------------------------------------------------
+// BRIG ARCHIVE
+
+// An archive starts with BrigArchiveHeader followed by the index: the
+// entries of all modules, two lookup tables and the module names. The
+// modules follow the index, each aligned to 16 bytes so that the modules
+// of a mapped archive can be used in place. All offsets are from the start
+// of the archive.
+//
+// Lookup tables are open-addressed hash tables of tableSize slots, keyed
+// by the hash of module names and by module content hashes respectively.
+// Slots hold the number of the module entry plus one, 0 for empty slots.
+// Collisions are resolved by linear probing; tableSize is at least twice
+// the number of modules, so lookups probe about one slot.
+
+struct BrigArchiveHeader {
+    char     identification[8]; // "HSA BRAR"
+    uint32_t version;
+    uint32_t moduleCount;
+    uint32_t tableSize;         // a power of 2
+    uint32_t reserved;
+    uint64_t entries;           // moduleCount BrigArchiveIndexEntry
+    uint64_t nameTable;         // tableSize slots keyed by name hash
+    uint64_t hashTable;         // tableSize slots keyed by content hash
+    uint64_t names;             // nul terminated module names
+    uint64_t byteCount;
+};
+
+struct BrigArchiveIndexEntry {
+    uint64_t hash;              // content hash of the module
+    uint64_t nameHash;
+    uint64_t offset;
+    uint64_t byteCount;
+    uint32_t name;              // offset of the name from names
+    uint32_t nameLength;
+};
+
+static const char     BRIG_ARCHIVE_IDENT[] = "HSA BRAR";
+static const uint32_t BRIG_ARCHIVE_VERSION = 1;
+static const unsigned BRIG_ARCHIVE_MODULE_ALIGNMENT = 16;
+
+static uint64_t archiveNameHash(const char* name, size_t length) {
+    ContentHasher h;
+    h.update(name, length);
+    return h.digest();
+}
+
+/// module names become file names on extraction, so they must not refer
+/// to other directories.
+static bool isValidArchiveName(const std::string& name) {
+    return !name.empty() &&
+           name.find_first_of(std::string("/\\\0", 3)) == std::string::npos &&
+           name.find("..") == std::string::npos;
+}
+
+static void insertArchiveSlot(std::vector<uint32_t>& table, uint64_t key, uint32_t entry) {
+    size_t const mask = table.size() - 1;
+    size_t slot = (size_t)key & mask;
+    while (table[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    table[slot] = entry + 1;
+}
+
+int BrigIO::saveArchive(const std::vector<BrigContainer*>& modules,
+                        const std::vector<std::string>&    names,
+                        WriteAdapter&                      dst)
+{
+    assert(modules.size() == names.size());
+    if (modules.size() >= (std::numeric_limits<uint32_t>::max)() / 2) {
+        dst.errs << "Too many modules for Brig archive" << std::endl;
+        return 1;
+    }
+    uint32_t const moduleCount = (uint32_t)modules.size();
+    uint32_t tableSize = 2;
+    while (tableSize < 2 * moduleCount) tableSize <<= 1;
+
+    std::vector<BrigArchiveIndexEntry> entries(moduleCount);
+    std::vector<uint32_t> nameTable(tableSize, 0), hashTable(tableSize, 0);
+    std::vector<const BrigModuleHeader*> moduleHeaders(moduleCount);
+    std::string nameBytes;
+    std::unordered_set<std::string> uniqueNames;
+
+    for(uint32_t i = 0; i < moduleCount; ++i) {
+        const std::string& name = names[i];
+        if (!isValidArchiveName(name)) {
+            dst.errs << "Invalid module name for Brig archive: " << name << std::endl;
+            return 1;
+        }
+        if (!uniqueNames.insert(name).second) {
+            dst.errs << "Duplicate module name in Brig archive: " << name << std::endl;
+            return 1;
+        }
+        if (nameBytes.size() + name.size() >= (std::numeric_limits<uint32_t>::max)()) {
+            dst.errs << "Module names are too long for Brig archive" << std::endl;
+            return 1;
+        }
+        moduleHeaders[i] = modules[i]->getBrigModule();
+
+        BrigArchiveIndexEntry& e = entries[i];
+        e.hash = modules[i]->contentHash();
+        e.nameHash = archiveNameHash(name.data(), name.size());
+        e.byteCount = moduleHeaders[i]->byteCount;
+        e.name = (uint32_t)nameBytes.size();
+        e.nameLength = (uint32_t)name.size();
+        nameBytes.append(name);
+        nameBytes.push_back('\0');
+
+        insertArchiveSlot(nameTable, e.nameHash, i);
+        insertArchiveSlot(hashTable, e.hash, i);
+    }
+
+    BrigArchiveHeader hdr;
+    memcpy(hdr.identification, BRIG_ARCHIVE_IDENT, sizeof hdr.identification);
+    hdr.version = BRIG_ARCHIVE_VERSION;
+    hdr.moduleCount = moduleCount;
+    hdr.tableSize = tableSize;
+    hdr.reserved = 0;
+    hdr.entries = sizeof hdr;
+    hdr.nameTable = hdr.entries + (uint64_t)moduleCount * sizeof(BrigArchiveIndexEntry);
+    hdr.hashTable = hdr.nameTable + (uint64_t)tableSize * sizeof(uint32_t);
+    hdr.names = hdr.hashTable + (uint64_t)tableSize * sizeof(uint32_t);
+    uint64_t end = hdr.names + nameBytes.size();
+    for(uint32_t i = 0; i < moduleCount; ++i) {
+        entries[i].offset = align(end, BRIG_ARCHIVE_MODULE_ALIGNMENT);
+        end = entries[i].offset + entries[i].byteCount;
+    }
+    hdr.byteCount = end;
+
+    std::vector<WriteAdapter::Fragment> frags;
+    frags.reserve(2 * moduleCount + 8);
+    uint64_t pos = 0;
+    addFragment(frags, pos, 0, (const char*)&hdr, sizeof hdr);
+    addFragment(frags, pos, hdr.entries, (const char*)entries.data(),
+                       entries.size() * sizeof(BrigArchiveIndexEntry));
+    addFragment(frags, pos, hdr.nameTable, (const char*)&nameTable[0],
+                       tableSize * sizeof(uint32_t));
+    addFragment(frags, pos, hdr.hashTable, (const char*)&hashTable[0],
+                       tableSize * sizeof(uint32_t));
+    addFragment(frags, pos, hdr.names, nameBytes.data(), nameBytes.size());
+    for(uint32_t i = 0; i < moduleCount; ++i) {
+        addFragment(frags, pos, entries[i].offset,
+                           (const char*)moduleHeaders[i], (size_t)entries[i].byteCount);
+    }
+    if (dst.writev(&frags[0], frags.size())) {
+        dst.errs << "cannot write Brig archive" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+static int readArchiveHeader(ReadAdapter& src, BrigArchiveHeader& hdr) {
+    if (src.pread((char*)&hdr, sizeof hdr, 0) ||
+        memcmp(hdr.identification, BRIG_ARCHIVE_IDENT, sizeof hdr.identification) != 0) {
+        src.errs << "Not a Brig archive" << std::endl;
+        return 1;
+    }
+    IOAdapter::Position const size = src.getSize();
+    // NB: tables of moduleCount < 2^31 and tableSize < 2^32 entries
+    // cannot overflow 64-bit offsets
+    if (hdr.version != BRIG_ARCHIVE_VERSION ||
+        hdr.tableSize == 0 || (hdr.tableSize & (hdr.tableSize - 1)) != 0 ||
+        hdr.tableSize <= hdr.moduleCount ||
+        hdr.entries < sizeof hdr ||
+        hdr.nameTable < hdr.entries + (uint64_t)hdr.moduleCount * sizeof(BrigArchiveIndexEntry) ||
+        hdr.hashTable < hdr.nameTable + (uint64_t)hdr.tableSize * sizeof(uint32_t) ||
+        hdr.names < hdr.hashTable + (uint64_t)hdr.tableSize * sizeof(uint32_t) ||
+        hdr.byteCount < hdr.names ||
+        (size != (IOAdapter::Position)-1 && hdr.byteCount > size)) {
+        src.errs << "Invalid Brig archive header" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+static int readArchiveEntry(ReadAdapter& src, const BrigArchiveHeader& hdr,
+                            uint32_t index, BrigArchiveIndexEntry& e) {
+    if (index >= hdr.moduleCount ||
+        src.pread((char*)&e, sizeof e, hdr.entries + (uint64_t)index * sizeof e)) {
+        src.errs << "Invalid Brig archive index" << std::endl;
+        return 1;
+    }
+    if (e.offset % BRIG_ARCHIVE_MODULE_ALIGNMENT != 0 ||
+        e.offset > hdr.byteCount || e.byteCount > hdr.byteCount - e.offset ||
+        e.name > hdr.byteCount - hdr.names ||
+        e.nameLength >= hdr.byteCount - hdr.names - e.name) {
+        src.errs << "Invalid Brig archive entry #" << index << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+static int readArchiveEntry(ReadAdapter& src, const BrigArchiveHeader& hdr,
+                            const BrigArchiveIndexEntry& e, BrigArchiveEntry& entry) {
+    entry.name.resize(e.nameLength);
+    if (e.nameLength > 0 &&
+        src.pread(&entry.name[0], e.nameLength, hdr.names + e.name)) {
+        return 1;
+    }
+    if (!isValidArchiveName(entry.name)) {
+        src.errs << "Invalid module name in Brig archive: " << entry.name << std::endl;
+        return 1;
+    }
+    entry.hash = e.hash;
+    entry.offset = e.offset;
+    entry.byteCount = e.byteCount;
+    return 0;
+}
+
+/// probe the lookup table at tableOffset for key, calling match for
+/// entries found until it returns true.
+template <typename Match>
+static int lookupArchive(ReadAdapter& src, const BrigArchiveHeader& hdr,
+                         uint64_t tableOffset, uint64_t key, Match match,
+                         BrigArchiveIndexEntry& e) {
+    uint32_t const mask = hdr.tableSize - 1;
+    uint32_t slot = (uint32_t)key & mask;
+    for(uint32_t probes = 0; probes < hdr.tableSize; ++probes, slot = (slot + 1) & mask) {
+        uint32_t entry;
+        if (src.pread((char*)&entry, sizeof entry, tableOffset + (uint64_t)slot * sizeof entry)) {
+            return 1;
+        }
+        if (entry == 0) break;
+        if (readArchiveEntry(src, hdr, entry - 1, e)) return 1;
+        int const rc = match(e);
+        if (rc != 0) return rc > 0 ? 0 : 1;
+    }
+    return -1;
+}
+
+int BrigIO::listArchive(ReadAdapter&                   src,
+                        std::vector<BrigArchiveEntry>& entries)
+{
+    BrigArchiveHeader hdr;
+    if (readArchiveHeader(src, hdr)) return 1;
+    entries.resize(hdr.moduleCount);
+    for(uint32_t i = 0; i < hdr.moduleCount; ++i) {
+        BrigArchiveIndexEntry e;
+        if (readArchiveEntry(src, hdr, i, e) ||
+            readArchiveEntry(src, hdr, e, entries[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int BrigIO::findInArchive(ReadAdapter&      src,
+                          const char*       name,
+                          BrigArchiveEntry& entry)
+{
+    BrigArchiveHeader hdr;
+    if (readArchiveHeader(src, hdr)) return 1;
+    size_t const length = strlen(name);
+    uint64_t const nameHash = archiveNameHash(name, length);
+    std::string candidate;
+    BrigArchiveIndexEntry e;
+    int const rc = lookupArchive(src, hdr, hdr.nameTable, nameHash,
+        [&](const BrigArchiveIndexEntry& c) -> int {
+            if (c.nameHash != nameHash || c.nameLength != length) return 0;
+            candidate.resize(length);
+            if (length > 0 && src.pread(&candidate[0], length, hdr.names + c.name)) return -1;
+            return candidate.compare(0, length, name, length) == 0 ? 1 : 0;
+        }, e);
+    if (rc != 0) return rc;
+    return readArchiveEntry(src, hdr, e, entry);
+}
+
+int BrigIO::findInArchive(ReadAdapter&      src,
+                          uint64_t          hash,
+                          BrigArchiveEntry& entry)
+{
+    BrigArchiveHeader hdr;
+    if (readArchiveHeader(src, hdr)) return 1;
+    BrigArchiveIndexEntry e;
+    int const rc = lookupArchive(src, hdr, hdr.hashTable, hash,
+        [&](const BrigArchiveIndexEntry& c) -> int {
+            return c.hash == hash ? 1 : 0;
+        }, e);
+    if (rc != 0) return rc;
+    return readArchiveEntry(src, hdr, e, entry);
+}
+
+static int loadArchiveEntry(BrigContainer& dst, ReadAdapter& src,
+                            const BrigArchiveEntry& entry, int mode) {
+    std::unique_ptr<ReadAdapter> const module =
+        BrigIO::fragmentReadingAdapter(&src, entry.byteCount, entry.offset);
+    return BrigIO::load(dst, FILE_FORMAT_AUTO, *module, mode);
+}
+
+int BrigIO::loadFromArchive(BrigContainer& dst,
+                            ReadAdapter&   src,
+                            const char*    name,
+                            int            mode)
+{
+    BrigArchiveEntry entry;
+    int const rc = findInArchive(src, name, entry);
+    if (rc < 0) {
+        src.errs << "Module " << name << " not found in Brig archive" << std::endl;
+    }
+    if (rc != 0) return 1;
+    return loadArchiveEntry(dst, src, entry, mode);
+}
+
+int BrigIO::loadFromArchive(BrigContainer& dst,
+                            ReadAdapter&   src,
+                            uint64_t       hash,
+                            int            mode)
+{
+    BrigArchiveEntry entry;
+    int const rc = findInArchive(src, hash, entry);
+    if (rc < 0) {
+        src.errs << "Module with hash " << std::hex << hash << std::dec
+                 << " not found in Brig archive" << std::endl;
+    }
+    if (rc != 0) return 1;
+    return loadArchiveEntry(dst, src, entry, mode);
+}
+
 // --------------------------------------------------------------------------------
 // BRIG BLOB VALIDATOR
 
@@ -1080,16 +1815,31 @@ bool BrigBlobValidator::validate() const
     return true;
 }
 
+const char* BrigBlobValidator::view(char* buf, uint64_t numBytes, uint64_t offset) const
+{
+    // callers check that the bytes are within the blob
+    if (blob) return blob + offset;
+    return read(buf, numBytes, offset) ? buf : 0;
+}
+
 void BrigBlobValidator::validateBrig() const
 {
-    BrigModuleHeader moduleHdr;
     ModuleMap map;
 
     uint64_t fileSize = size();
     validate(fileSize != (uint64_t)-1, "Filed to read file size");
 
+    // blobs in memory are validated in place, provided that their headers
+    // and section index can be accessed there
+    blob = contents();
+    if (reinterpret_cast<uintptr_t>(blob) % MODULE_INDEX_ALIGNMENT != 0) blob = 0;
+
     validate(fileSize > sizeof(BrigModuleHeader), "File is too small for BRIG or ELF");
-    validate(read((char*)&moduleHdr, sizeof(BrigModuleHeader), 0), "Failed to read BrigModuleHeader");
+    BrigModuleHeader hdrBuf;
+    const BrigModuleHeader* const pModuleHdr =
+        (const BrigModuleHeader*)view((char*)&hdrBuf, sizeof(BrigModuleHeader), 0);
+    validate(pModuleHdr != 0, "Failed to read BrigModuleHeader");
+    const BrigModuleHeader& moduleHdr = *pModuleHdr;
 
     if (memcmp("HSA BRIG", moduleHdr.identification, sizeof(moduleHdr.identification)) != 0) {
         validate(false, "Unsupported file format");
@@ -1115,10 +1865,13 @@ void BrigBlobValidator::validateBrig() const
     map[moduleHdr.sectionIndex] = secIdxSize;
 
     uint64_t sectionSize;
-    uint64_t sectionOffset;
+    uint64_t offsetBuf;
     for (unsigned idx = 0; idx < moduleHdr.sectionCount; ++idx)
     {
-        validate(read((char*)&sectionOffset, sizeof(uint64_t), moduleHdr.sectionIndex + idx * sizeof(uint64_t)), "Failed to read section index");
+        const uint64_t* const pSectionOffset =
+            (const uint64_t*)view((char*)&offsetBuf, sizeof(uint64_t), moduleHdr.sectionIndex + idx * sizeof(uint64_t));
+        validate(pSectionOffset != 0, "Failed to read section index");
+        uint64_t const sectionOffset = *pSectionOffset;
         sectionSize = validateSection((BrigSectionIndex)idx, sectionOffset, fileSize);
         
         validate(map.count(sectionOffset) == 0, "BRIG module elements must not overlap");
@@ -1131,11 +1884,14 @@ void BrigBlobValidator::validateBrig() const
     // Gaps between sections are only allowed to satisfy the required alignment
     for (ModuleMap::iterator it = map.begin(); it != map.end(); ++it)
     {
-        uint64_t nextPos;
         uint64_t pos = it->first + it->second;
         assert(pos <= fileSize);
 
-        for (nextPos = pos; nextPos - pos < MODULE_SECTION_ALIGNMENT && nextPos < fileSize && map.count(nextPos) == 0; ++nextPos);
+        // the padding ends at the first element at or after pos, the end
+        // of the module or after MODULE_SECTION_ALIGNMENT bytes
+        ModuleMap::const_iterator const next = map.lower_bound(pos);
+        uint64_t nextPos = (std::min)(fileSize, pos + MODULE_SECTION_ALIGNMENT);
+        if (next != map.end()) nextPos = (std::min)(nextPos, next->first);
 
         validate(nextPos == fileSize || map.count(nextPos) != 0, "BRIG module elements must follow each other without gaps and overlapping");
         validate(nextPos != moduleHdr.sectionIndex || 
@@ -1143,11 +1899,15 @@ void BrigBlobValidator::validateBrig() const
 
         actualSize += it->second + (nextPos - pos);
 
-        for (; pos < nextPos; ++pos)
+        if (pos < nextPos)
         {
-            char pad;
-            validate(read(&pad, 1, pos), "Failed to read section alignment bytes");
-            validate(pad == 0,           "Padding between BRIG module elements must be filled with zero");
+            char padBuf[MODULE_SECTION_ALIGNMENT];
+            const char* const pad = view(padBuf, nextPos - pos, pos);
+            validate(pad != 0, "Failed to read section alignment bytes");
+            for (uint64_t i = 0; i < nextPos - pos; ++i)
+            {
+                validate(pad[i] == 0, "Padding between BRIG module elements must be filled with zero");
+            }
         }
     }
 
@@ -1159,7 +1919,7 @@ uint64_t BrigBlobValidator::validateSection(BrigSectionIndex sectionIndex,
                                             uint64_t sectionOffset,
                                             uint64_t fileSize) const
 {
-    BrigSectionHeader sectionHeader;
+    BrigSectionHeader headerBuf;
 
     // NB: do not use addition to avoid overflow
     // NB: compute "a-b" only after checking that "a>b"
@@ -1167,7 +1927,10 @@ uint64_t BrigBlobValidator::validateSection(BrigSectionIndex sectionIndex,
     validate(sectionOffset % MODULE_SECTION_ALIGNMENT == 0,                          "Invalid section offset: must be a multiple of ", MODULE_SECTION_ALIGNMENT);
     validate(sectionOffset < fileSize,                                               "Invalid section offset: section offset is outside of BRIG module");
     validate(fileSize - sectionOffset > sizeof(BrigSectionHeader),                   "Invalid section offset: section header does not fit into BRIG module");
-    validate(read((char*)&sectionHeader, sizeof(BrigSectionHeader), sectionOffset),  "Failed to read section header");
+    const BrigSectionHeader* const pSectionHeader =
+        (const BrigSectionHeader*)view((char*)&headerBuf, sizeof(BrigSectionHeader), sectionOffset);
+    validate(pSectionHeader != 0,                                                    "Failed to read section header");
+    const BrigSectionHeader& sectionHeader = *pSectionHeader;
     validate(sectionHeader.byteCount % MODULE_SECTION_SIZE_ALIGNMENT == 0,           "Invalid section size: must be a multiple of ", MODULE_SECTION_SIZE_ALIGNMENT);
     validate(fileSize - sectionOffset >= sectionHeader.byteCount,                    "Invalid section size: section does not fit into BRIG module");
 
@@ -1190,9 +1953,11 @@ uint64_t BrigBlobValidator::validateSection(BrigSectionIndex sectionIndex,
     if (name && strlen(name) > 0)
     {
         assert(strlen(name) < MAX_PREDEFINED_SECTION_NAME_LENGTH);
-        char buf[MAX_PREDEFINED_SECTION_NAME_LENGTH];
-        validate(read((char*)&buf, strlen(name), sectionOffset + offsetof(BrigSectionHeader, name)), "Failed to read section name");
-        validate(sectionHeader.nameLength == strlen(name) && memcmp(name, buf, strlen(name)) == 0, "Invalid name of a standard section");
+        char nameBuf[MAX_PREDEFINED_SECTION_NAME_LENGTH];
+        validate(sectionHeader.nameLength == strlen(name), "Invalid name of a standard section");
+        const char* const sectionName = view(nameBuf, strlen(name), sectionOffset + offsetof(BrigSectionHeader, name));
+        validate(sectionName != 0, "Failed to read section name");
+        validate(memcmp(name, sectionName, strlen(name)) == 0, "Invalid name of a standard section");
     }
 
     //NB: validation of other section requirements are performed by HSAILValidator
@@ -64,7 +64,10 @@ enum BinaryFileFormat {
     FILE_FORMAT_BIF  = 2,
     FILE_FORMAT_MASK = 0xf,
     FILE_FORMAT_ELF32 = 0,
-    FILE_FORMAT_ELF64 = 0x10
+    FILE_FORMAT_ELF64 = 0x10,
+    /// compress BRIG modules on save. Compressed modules are recognized
+    /// on load regardless of format.
+    FILE_FORMAT_COMPRESSED = 0x100
 };
 
 /// virtual base for the adapters
@@ -95,6 +98,17 @@ public:
     virtual ~WriteAdapter() = 0;
     virtual int write(const char* data, size_t numBytes) const = 0;
 
+    /// piece of data written by writev.
+    struct Fragment {
+        const char* data;
+        size_t      numBytes;
+    };
+
+    /// write fragments one after another. The default implementation
+    /// calls write for each of them, adapters may override it to write
+    /// all fragments at once (e.g. with a single vectored system call).
+    virtual int writev(const Fragment* fragments, size_t numFragments) const;
+
     int writeAlignPad(unsigned pow2);
 
     template <typename C>
@@ -109,6 +123,24 @@ public:
     }
 };
 
+/// Brig module of a container described as fragments referring to the
+/// container sections, see BrigContainer::getModuleImage. The fragments
+/// also refer to the header and section index held here, hence the image
+/// cannot be copied.
+struct BrigModuleImage {
+    BrigModuleHeader                    header;
+    std::vector<uint64_t>               sectionIndex;
+    std::vector<WriteAdapter::Fragment> fragments;
+
+    BrigModuleImage() {}
+
+    uint64_t byteCount() const { return header.byteCount; }
+
+private:
+    BrigModuleImage(const BrigModuleImage&);
+    BrigModuleImage& operator=(const BrigModuleImage&);
+};
+
 class NullWriteAdapter : public WriteAdapter {
     mutable Position pos;
 public:
@@ -136,6 +168,16 @@ public:
     virtual int pread(char* data, size_t numBytes, uint64_t ofs) const = 0;
     virtual Position getSize() const { return (Position)-1; };
 
+    /// return the adapter contents if they are kept in memory which may
+    /// outlive the adapter (e.g. a mapped file), null otherwise. The result
+    /// shares ownership of that memory, so Brig can be used in-place.
+    virtual std::shared_ptr<const char> sharedData() const { return std::shared_ptr<const char>(); }
+
+    /// return the adapter contents if they are kept in memory, null
+    /// otherwise. Unlike sharedData, the result is only valid as long as
+    /// the adapter and its contents are (e.g. a caller's buffer).
+    virtual const char* contents() const { return NULL; }
+
     virtual ~ReadAdapter() = 0;
 };
 
@@ -150,6 +192,14 @@ public:
     virtual ~ReadWriteAdapter() = 0;
 };
 
+/// module stored in a Brig archive, see BrigIO::saveArchive.
+struct BrigArchiveEntry {
+    std::string name;
+    uint64_t    hash;      // content hash, see BrigContainer::contentHash
+    uint64_t    offset;    // of the module from the start of the archive
+    uint64_t    byteCount;
+};
+
 struct BrigIO {
 
     static std::ostream& defaultErrs();
@@ -160,6 +210,14 @@ struct BrigIO {
                     const char*                 fileName,
                     std::ostream&               errs = defaultErrs());
 
+    /// map the file into memory. RO and copy-on-write containers loaded
+    /// from this adapter refer to the mapping directly and keep it alive,
+    /// writable ones copy their sections. Falls back to fileReadingAdapter
+    /// where the file cannot be mapped.
+    static std::unique_ptr<ReadAdapter> mappedFileReadingAdapter(
+                    const char*                 fileName,
+                    std::ostream&               errs = defaultErrs());
+
     static std::unique_ptr<WriteAdapter> fileWritingAdapter(
                     const char*                 fileName,
                     std::ostream&               errs = defaultErrs());
@@ -195,10 +253,11 @@ struct BrigIO {
                     int                         fmt,
                     WriteAdapter&               dst);
 
+    /// @param mode - one of BrigLoadMode.
     static int load(BrigContainer&              dst,
                     int                         fmt,
                     ReadAdapter&                src,
-                    bool                        writable = false);
+                    int                         mode = LOAD_READ_ONLY);
 
     // API taking ownership of the adapters, to  be used with the factory
     // methods above
@@ -213,12 +272,62 @@ struct BrigIO {
     static int load(BrigContainer&               dst,
                     int                          fmt,
                     std::unique_ptr<ReadAdapter> src,
-                    bool                         writable = false)
+                    int                          mode = LOAD_READ_ONLY)
     {
-        return !src.get() || load(dst, fmt, *src, writable);
+        return !src.get() || load(dst, fmt, *src, mode);
     }
 
+    /// load Brig module reading each section on first access through
+    /// BrigContainer::sectionById, so sections never used are never read.
+    /// The container is writable and keeps src until all its sections are
+    /// loaded. Modules which can be used in place (e.g. from mapped files)
+    /// are not read section by section but loaded with LOAD_COPY_ON_WRITE,
+    /// and compressed modules are decompressed at once with LOAD_WRITABLE.
+    /// Sections which fail to load on first access are reported by
+    /// BrigContainer::lazyLoadFailed.
+    static int loadLazily(BrigContainer&               dst,
+                          int                          fmt,
+                          std::shared_ptr<ReadAdapter> src);
+
     static int validateBrigBlob(ReadAdapter&         src);
+
+    // Brig archives hold many Brig modules, with an index mapping
+    // module names and content hashes to the modules
+
+    /// write archive of modules stored under names. The modules are made
+    /// RO (see BrigContainer::getBrigModule) and written as is.
+    static int saveArchive(const std::vector<BrigContainer*>& modules,
+                           const std::vector<std::string>&    names,
+                           WriteAdapter&                      dst);
+
+    /// read the index of the archive read by src.
+    static int listArchive(ReadAdapter&                       src,
+                           std::vector<BrigArchiveEntry>&     entries);
+
+    /// look up a module of the archive read by src by its name or content
+    /// hash. Only the header and the index entries probed are read, so the
+    /// time taken does not depend on the number of modules.
+    /// @return 0 if found, -1 if there is no such module, 1 on error.
+    static int findInArchive(ReadAdapter&                     src,
+                             const char*                      name,
+                             BrigArchiveEntry&                entry);
+
+    static int findInArchive(ReadAdapter&                     src,
+                             uint64_t                         hash,
+                             BrigArchiveEntry&                entry);
+
+    /// load a module of the archive read by src, found by findInArchive.
+    /// The module is read through fragmentReadingAdapter, so modules of
+    /// mapped archives are used in place.
+    static int loadFromArchive(BrigContainer&                 dst,
+                               ReadAdapter&                   src,
+                               const char*                    name,
+                               int                            mode = LOAD_READ_ONLY);
+
+    static int loadFromArchive(BrigContainer&                 dst,
+                               ReadAdapter&                   src,
+                               uint64_t                       hash,
+                               int                            mode = LOAD_READ_ONLY);
 };
 
 // old style compatibility API
@@ -295,9 +404,22 @@ private:
     void validate(bool cond, const char* msg) const;
     void validate(bool cond, const char* msg, unsigned val) const;
 
+    /// pointer to numBytes of the blob at offset. The blob is used in
+    /// place when its contents are in memory, otherwise the bytes are
+    /// read into buf. Returns null if the bytes cannot be read.
+    const char* view(char* buf, uint64_t numBytes, uint64_t offset) const;
+
+    mutable const char* blob;
+
 protected:
+    BrigBlobValidator() : blob(0) {}
+
     virtual uint64_t size() const = 0;
     virtual bool read(char* dst, uint64_t numBytes, uint64_t offset) const = 0;
+
+    /// blob contents if they are in memory, so that the blob is validated
+    /// in place, null otherwise.
+    virtual const char* contents() const { return 0; }
 };
 
 } // namespace
@@ -97,6 +97,7 @@ void Brigantine::endProgram()
 {
     m_globalScope.reset();
     m_container.patchDecl2Defs();
+    m_operandBytesSaved = m_optimizeOperands ? m_container.optimizeOperands() : 0;
 }
 
 DirectiveModule Brigantine::module(
@@ -536,7 +537,8 @@ Operand Brigantine::createLabelList(const std::vector<SRef>& labels, const Sourc
     for(unsigned i=0; i<labels.size(); ++i) {
       dummy.push_back(Code());
     }
-    ref = dummy;
+    // labels may be defined later, so elements are patched in place
+    ref.assignUnshared(dummy);
     for(unsigned i = 0; i<labels.size(); ++i) {
       recordLabelRef(ref.writeAccess(i), labels[i], srcInfo);
     }
@@ -640,7 +642,9 @@ void Brigantine::addSymbolToLocalScope(DirectiveVariable sym) {
     if (m_argScope.get()) {
         m_argScope->add(sym.name(), sym);
     } else {
-        brigWriteError("no argument scope available at this location",sym.srcInfo());
+        SourceInfo const srcInfo = sym.srcInfo();
+        brigWriteError("no argument scope available at this location",
+                       srcInfo.line != -1 ? &srcInfo : NULL);
     }
 }
 
@@ -652,5 +656,36 @@ void Brigantine::setOperands(Inst inst, ItemList operands)
 
 }
 
+void Brigantine::setOperands(Inst inst, const Operand* operands, unsigned numOperands)
+{
+    Offset offsets[8];
+    if (numOperands > sizeof(offsets)/sizeof(offsets[0])) {
+        ItemList list;
+        for(unsigned i = 0; i < numOperands; ++i) {
+            list.push_back(operands[i]);
+        }
+        setOperands(inst, list);
+        return;
+    }
+    for(unsigned i = 0; i < numOperands; ++i) {
+        assert(!operands[i] || operands[i].section() == &m_container.operands());
+        offsets[i] = operands[i].brigOffset();
+    }
+    const char* const data = reinterpret_cast<const char*>(offsets);
+    inst.operands().deref() = m_container.addString(SRef(data, data + numOperands * sizeof(Offset)));
+}
+
+void Brigantine::beginBatch(size_t codeBytes, size_t operandBytes)
+{
+    m_container.code().beginAppendBatch(codeBytes);
+    m_container.operands().beginAppendBatch(operandBytes);
+}
+
+void Brigantine::endBatch()
+{
+    m_container.code().endAppendBatch();
+    m_container.operands().endAppendBatch();
+}
+
 // Brigantine end
 }
@@ -68,6 +68,8 @@ class Brigantine
     DirectiveExecutable     m_func;
     unsigned                m_machine;
     unsigned                m_profile;
+    bool                    m_optimizeOperands;
+    size_t                  m_operandBytesSaved;
 
     typedef std::vector< std::pair< ItemRef<Code>, SourceInfo > > RefList;
     typedef std::map<BrigDataOffset32_t, RefList> LabelMap;
@@ -83,16 +85,28 @@ public:
     /// won't syncronize it's state with it and therefore it is up to the user to
     /// supply the container in a state that allows to 'continue' writing consistently.
     /// Most common case is an empty Brig container.
-    Brigantine(BrigContainer& container) : m_container(container), m_machine(BRIG_MACHINE_UNDEF), m_profile(BRIG_PROFILE_UNDEF) {}
+    Brigantine(BrigContainer& container)
+        : m_container(container)
+        , m_machine(BRIG_MACHINE_UNDEF)
+        , m_profile(BRIG_PROFILE_UNDEF)
+        , m_optimizeOperands(true)
+        , m_operandBytesSaved(0) {}
     virtual ~Brigantine() {}
 
     /// start HSAIL program. While it doesn't write anything to the container it
     /// prepares Brigantine's state to begin Brig emitting.
     void startProgram();
     /// end HSAIL program.
-    /// Perform Brigantine's state cleanup.
+    /// Perform Brigantine's state cleanup and merge identical operands
+    /// unless operand optimizer is disabled.
     void endProgram();
 
+    /// enable or disable merging of identical operands by endProgram.
+    void setOperandOptimizer(bool enable) { m_optimizeOperands = enable; }
+
+    /// number of bytes the operand optimizer has saved on endProgram.
+    size_t operandBytesSaved() const { return m_operandBytesSaved; }
+
     /// @name Directives
     /// @{
 
@@ -212,6 +226,27 @@ public:
 
 
     void setOperands(Inst inst, ItemList operands);
+
+    /// set operands of inst from an array without building an ItemList.
+    void setOperands(Inst inst, const Operand* operands, unsigned numOperands);
+
+    /// @name Bulk emission
+    /// Room for the instructions and operands emitted between beginBatch
+    /// and endBatch is reserved up front, and the sections are resynced
+    /// once per batch rather than once per item. Items are still appended
+    /// and initialized one at a time; only the per-append resync is saved.
+    /// Container contents are the same as without a batch; exceeding the
+    /// reserved room is allowed but falls back to the regular path.
+    /// Appends inside the reserved room skip syncWithBuffer and the
+    /// section sync callback, so section data pointers and items taken
+    /// before the batch may be stale until endBatch resyncs them.
+    /// @param codeBytes - bytes to reserve in code section, e.g.
+    ///        number of instructions times sizeof of their Brig structs.
+    /// @param operandBytes - bytes to reserve in operand section.
+    /// @{
+    void beginBatch(size_t codeBytes, size_t operandBytes);
+    void endBatch();
+    /// @}
     //void setOperandEx(Inst inst, int i, Operand opnd);
 
     template<typename Item>
@@ -96,15 +96,21 @@ using namespace HSAIL_PROPS;
 
 template <typename Float>
 inline void printFloatValueImpl(std::ostream& stream, int mode, Float val) {
+    typedef IEEE754Traits<Float> Traits;
+
+    // Inf and NaN have no C99 or decimal literal, raw bits keep them exact
+    if ((val.rawBits() & Traits::expMask) == Traits::expMask) {
+        mode = FloatDisassemblyModeRawBits;
+    }
+
+    char buf[maxFloatCharsLength];
     switch(mode) {
     case FloatDisassemblyModeRawBits:
-      stream << IEEE754Traits<Float>::hexPrefix << PrintHex(val.rawBits()); break;
+      stream << Traits::hexPrefix << PrintHex(val.rawBits()); break;
     case FloatDisassemblyModeC99:
-      stream << toC99str(val); break;
+      stream.write(buf, toC99Chars(val, buf)); break;
     case FloatDisassemblyModeDecimal:
-      // \todo this might require explicit NaN processing in case the standard library is unable to print it properly
-      stream.setf(std::ios::showpoint);
-      stream << val.floatValue() << IEEE754Traits<Float>::suffix; break;
+      stream.write(buf, toDecimalChars(val, buf)); break;
     default:
       assert(0);
     }
@@ -355,15 +355,22 @@ private:
         s << "minor: "; dumpValue(header->brigMinor); s << ", ";
         s << "byteCount: "; dumpValue(header->byteCount); s << ", ";
         s << "hash: ";
-        dumpValue(
-            SRef(reinterpret_cast<const char *>(&header->hash[0]),
-                 reinterpret_cast<const char *>(&header->hash[63])));
+        dumpHash(header->hash);
         s << ", ";
         s << "sectionCount: "; dumpValue(header->sectionCount); s << ", ";
         s << "sectionIndex: "; dumpValue(header->sectionIndex);
         s << "}\n";
     }
 
+    template <size_t N>
+    void dumpHash(const uint8_t (&hash)[N]) {
+        static const char digits[] = "0123456789abcdef";
+        s << "0x";
+        for (size_t i = 0; i < N; ++i) {
+            s << digits[hash[i] >> 4] << digits[hash[i] & 0xf];
+        }
+    }
+
     void dumpSectionIndex(BrigContainer& c, uint64_t sectionIndexOffset) {
         BrigModule_t module = c.getBrigModule();
         uint64_t* sectionIndex = reinterpret_cast<uint64_t *>(module) + (sectionIndexOffset / sizeof(uint64_t));
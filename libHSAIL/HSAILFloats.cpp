@@ -40,12 +40,11 @@
 // SOFTWARE.
 #include "HSAILFloats.h"
 #include "HSAILSRef.h"
-#include <iosfwd>
-#include <sstream>
+#include <ostream>
 #include <string>
-#include <iomanip>
 #include <cassert>
 #include <algorithm>
+#include <limits>
 
 #include <cmath> // for tests
 #ifdef ANDROID
@@ -129,76 +128,131 @@ f32_t f16_t::halfp2singles(uint16_t src)
     return makeFloat<f32_t>(f32signBit,exp,f32mntsBits);
 }
 
+static char* printDecimal(char* p, int v)
+{
+    if (v < 0) {
+        *p++ = '-';
+        v = -v;
+    }
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) *p++ = digits[--n];
+    return p;
+}
+
+static char* printSuffix(char* p, const char* suffix)
+{
+    while (*suffix) *p++ = *suffix++;
+    return p;
+}
+
 template <typename Float>
-std::string toC99str(Float v)
+unsigned toC99Chars(Float v, char* buf)
 {
     typedef IEEE754Traits<Float> Traits;
 
     typename Traits::RawBitsType const srcBits = v.rawBits();
-    std::ostringstream res;
+    char* p = buf;
 
     if (srcBits & Traits::signMask) {
-        res << "-";
+        *p++ = '-';
     }
 
     if( (srcBits & ~Traits::signMask) == 0 ) {
-        res << "0.0"  << Traits::suffix;
-        return res.str();
+        *p++ = '0'; *p++ = '.'; *p++ = '0';
+        return static_cast<unsigned>(printSuffix(p, Traits::suffix) - buf);
     }
 
     const int mntsHDWidth = (Traits::mntsWidth/4) + ((Traits::mntsWidth%4)!=0 ? 1 : 0);
 
     typename Traits::RawBitsType mntsBits = (srcBits & Traits::mntsMask) << (mntsHDWidth*4 - Traits::mntsWidth);
-    int termZeroes = 0;
-    if (mntsBits!=0) {
-        while (!(mntsBits & 0xF)) {
-            mntsBits >>= 4;
-            ++termZeroes;
-        }
-    } else termZeroes = mntsHDWidth-1;
+    int numDigits = mntsHDWidth;
+    while (numDigits > 1 && !(mntsBits & 0xF)) {
+        mntsBits >>= 4;
+        --numDigits;
+    }
 
+    // denormals are 0x0.XXX times the smallest normalized exponent
     int const exp = static_cast<int>((srcBits & Traits::expMask) >> Traits::mntsWidth) - Traits::expBias;
-    if (exp==Traits::minExp) {
-        res << "0x0." << std::setw(mntsHDWidth-termZeroes);
-    } else {
-        res << "0x1." << std::setw(1);
+    bool const denorm = exp == Traits::minExp;
+    *p++ = '0'; *p++ = 'x'; *p++ = denorm ? '0' : '1'; *p++ = '.';
+    while (numDigits--) {
+        unsigned const digit = static_cast<unsigned>(mntsBits >> (numDigits*4)) & 0xF;
+        *p++ = static_cast<char>(digit < 10 ? '0' + digit : 'A' + digit - 10);
     }
+    *p++ = 'p';
+    p = printDecimal(p, denorm ? Traits::minExp + 1 : exp);
+    return static_cast<unsigned>(printSuffix(p, Traits::suffix) - buf);
+}
 
-    res << std::setfill('0') << std::hex << std::uppercase << mntsBits << "p" << std::dec << std::setw(1) << exp << Traits::suffix;
-
-    return res.str();
+template <typename Float>
+std::string toC99str(Float v)
+{
+    char buf[maxFloatCharsLength];
+    return std::string(buf, toC99Chars(v, buf));
 }
 
-static inline int digitValue(int c)
+static inline unsigned digitValue(char c)
 {
-    c = tolower(c);
-    if (c>='0' && c<='9') {
-        return c - '0';
-    } else if (c>='a' && c<='f') {
-        return c - 'a' + 10;
-    }
-    return -1;
+    unsigned const u = static_cast<unsigned char>(c);
+    return u <= '9' ? u - '0' : (u | 0x20) - 'a' + 10;
 }
 
-static inline int digitValueBitLen(int c)
+static inline int bitLength(uint64_t v)
 {
-    if (c>=8) return 4;
-    if (c>=4) return 3;
-    if (c>=2) return 2;
-    return 1;
+    int len = 0;
+    for(; v; v >>= 1) ++len;
+    return len;
 }
 
-class istringstreamalert : public std::istringstream {
-public:
-    istringstreamalert(const char* s, unsigned cnt)
-        : std::istringstream(std::string(s,cnt)) {
-        exceptions(std::ios::failbit | std::ios::badbit);
+/// Rounds (m + tail) * 2^exp2 to the nearest Float, ties to even. sticky tells
+/// whether the tail below the least significant bit of m is nonzero, m must not
+/// be zero. Values too large for Float become signed Inf.
+template <typename Float>
+static Float roundToFloat(typename IEEE754Traits<Float>::RawBitsType sign, uint64_t m, int exp2, bool sticky)
+{
+    typedef IEEE754Traits<Float> Traits;
+    typedef typename Traits::RawBitsType RawBitsType;
+    assert(m != 0);
+
+    int const exp = exp2 + bitLength(m) - 1;
+    if (exp >= Traits::maxExp) {
+        return Float::fromRawBits(static_cast<RawBitsType>(sign | Traits::expMask));
     }
-};
+
+    // weight of the last mantissa bit, denormals have fixed one
+    int const denormLsb = Traits::minExp + 1 - Traits::mntsWidth;
+    int const lsb = (std::max)(exp - Traits::mntsWidth, denormLsb);
+    int const shift = lsb - exp2;
+
+    uint64_t mnts;
+    if (shift <= 0) {
+        assert(!sticky);
+        mnts = m << -shift;
+    } else {
+        uint64_t const rest = shift < 64 ? m & ((static_cast<uint64_t>(1) << shift) - 1) : m;
+        uint64_t const half = shift <= 64 ? static_cast<uint64_t>(1) << (shift - 1) : 0;
+        mnts = shift < 64 ? m >> shift : 0;
+        if (half && (rest > half || (rest == half && (sticky || (mnts & 1))))) {
+            ++mnts; // may carry into exponent, which is exactly what rounding up needs
+        }
+    }
+
+    // the implicit bit of normalized values adds 1 to the biased exponent
+    uint64_t const bits = (static_cast<uint64_t>(lsb - denormLsb) << Traits::mntsWidth) + mnts;
+    if (bits >= Traits::expMask) {
+        return Float::fromRawBits(static_cast<RawBitsType>(sign | Traits::expMask));
+    }
+    return Float::fromRawBits(static_cast<RawBitsType>(sign | bits));
+}
 
 // this routine assumes valid input sequence (checked by re2c rules)
 template <typename Float>
-Float readC99(const SRef& s)
+bool readC99(const SRef& s, Float& res)
 {
     typedef IEEE754Traits<Float> Traits;
     const char * const end = s.end;
@@ -212,85 +266,515 @@ Float readC99(const SRef& s)
     case '0': p += 2;  // fallthrough
     }
 
-    typename Traits::RawBitsType mntsBits = 0;
-    int exp=0;
+    // keep at least 61 significant bits, the rest only matters for rounding
+    uint64_t mnts = 0;
+    int expShift = 0;
+    bool sticky = false, afterDot = false;
+    for(; (*p | 0x20) != 'p'; ++p) {
+        if (*p == '.') {
+            afterDot = true;
+        } else if (mnts >> 60) {
+            sticky |= *p != '0';
+            if (!afterDot) expShift += 4;
+        } else {
+            mnts = (mnts << 4) | digitValue(*p);
+            if (afterDot) expShift -= 4;
+        }
+    }
+
+    if (!mnts) {
+        res = Float::fromRawBits(sign); // signed zero
+        return true;
+    }
 
-    while (*p=='0') ++p; // skip leading zeroes
+    ++p;
+    bool const negExp = *p == '-';
+    if (*p == '-' || *p == '+') ++p;
+    int64_t const expLimit = negExp ? -static_cast<int64_t>((std::numeric_limits<int>::min)())
+                                    : (std::numeric_limits<int>::max)();
+    int64_t exp = 0;
+    for(; p != end && *p >= '0' && *p <= '9'; ++p) {
+        exp = exp * 10 + (*p - '0');
+        if (exp > expLimit) return false; // exponent does not fit int
+    }
+    exp = (negExp ? -exp : exp) + expShift;
 
-    if (tolower(*p)!='p') {
-        int const maxBits = Traits::mntsWidth + 1;
-        int bitCount=0, expShift=0;
-        if (*p=='.') { // no bits before dot
-            ++p;
-            while (*p=='0') expShift -=4, ++p; // shift exp until first bit
+    // far beyond the range of any format, rounds to Inf or zero anyway
+    int const expClamp = 100000;
+    exp = (std::max)((std::min)(exp, static_cast<int64_t>(expClamp)), static_cast<int64_t>(-expClamp));
 
-            if (tolower(*p)!='p') {
-                int const digit = digitValue(*p++); // read first nonzero digit
-                mntsBits = digit;
-                int const digBitLen = digitValueBitLen(digit);
-                bitCount += digBitLen;
-                expShift -= 4-digBitLen;
+    res = roundToFloat<Float>(sign, mnts, static_cast<int>(exp), sticky);
+    return true;
+}
+
+/// Fixed capacity unsigned integer, just enough arithmetic for exact decimal
+/// to binary conversion of float literals.
+class BigUInt
+{
+public:
+    BigUInt(uint64_t v = 0) : m_size(0) {
+        for(; v; v >>= 32) m_words[m_size++] = static_cast<uint32_t>(v);
+    }
+
+    bool isZero() const { return m_size == 0; }
+
+    void mulAdd(uint32_t mul, uint32_t add) {
+        uint64_t carry = add;
+        for(int i = 0; i < m_size; ++i) {
+            carry += static_cast<uint64_t>(m_words[i]) * mul;
+            m_words[i] = static_cast<uint32_t>(carry);
+            carry >>= 32;
+        }
+        if (carry) push(static_cast<uint32_t>(carry));
+    }
+
+    void mulPow10(int n) {
+        for(; n >= 9; n -= 9) mulAdd(1000000000u, 0);
+        static const uint32_t pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+        if (n) mulAdd(pow10[n], 0);
+    }
+
+    void shiftLeft(int n) {
+        if (isZero() || n == 0) return;
+        int const words = n / 32, bits = n % 32;
+        if (bits) push(0);
+        assert(m_size + words <= capacity);
+        for(int i = m_size; i-- > 0; ) {
+            uint32_t const lo = i > 0 && bits ? m_words[i-1] >> (32 - bits) : 0;
+            m_words[i + words] = (m_words[i] << bits) | lo;
+        }
+        std::fill(m_words, m_words + words, 0u);
+        m_size += words;
+        trim();
+    }
+
+    void shiftRight1() {
+        for(int i = 0; i < m_size; ++i) {
+            m_words[i] = (m_words[i] >> 1) | (i + 1 < m_size ? m_words[i+1] << 31 : 0);
+        }
+        trim();
+    }
+
+    int bitLength() const {
+        return m_size ? (m_size - 1) * 32 + HSAIL_ASM::bitLength(m_words[m_size-1]) : 0;
+    }
+
+    int compare(const BigUInt& rhs) const {
+        if (m_size != rhs.m_size) return m_size < rhs.m_size ? -1 : 1;
+        for(int i = m_size; i-- > 0; ) {
+            if (m_words[i] != rhs.m_words[i]) return m_words[i] < rhs.m_words[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    /// requires *this >= rhs
+    void subtract(const BigUInt& rhs) {
+        int64_t borrow = 0;
+        for(int i = 0; i < m_size; ++i) {
+            borrow += static_cast<int64_t>(m_words[i]) - (i < rhs.m_size ? rhs.m_words[i] : 0);
+            m_words[i] = static_cast<uint32_t>(borrow);
+            borrow = borrow < 0 ? -1 : 0;
+        }
+        trim();
+    }
+
+    /// Replaces *this with the remainder of division by den and returns the
+    /// quotient, which must fit 128 bits: the high half goes to qHi.
+    uint64_t divide(BigUInt den, uint64_t& qHi) {
+        uint64_t q = 0;
+        qHi = 0;
+        int const qLen = bitLength() - den.bitLength();
+        if (qLen < 0) return 0;
+        assert(qLen < 128);
+        den.shiftLeft(qLen);
+        for(int i = qLen; i >= 0; --i) {
+            qHi = (qHi << 1) | (q >> 63);
+            q <<= 1;
+            if (compare(den) >= 0) {
+                subtract(den);
+                q |= 1;
             }
+            if (i) den.shiftRight1();
+        }
+        return q;
+    }
+
+    /// Returns 64 bits starting at bit lo.
+    uint64_t bitsFrom(int lo) const {
+        uint64_t res = 0;
+        for(int b = 63; b >= 0; --b) {
+            res = (res << 1) | bit(lo + b);
+        }
+        return res;
+    }
+
+    bool anyBitBelow(int lo) const {
+        for(int i = 0; i < lo; ++i) {
+            if (bit(i)) return true;
+        }
+        return false;
+    }
+
+private:
+    static const int capacity = 128;
+
+    unsigned bit(int i) const {
+        return i / 32 < m_size ? (m_words[i / 32] >> (i % 32)) & 1 : 0;
+    }
+    void push(uint32_t w) {
+        assert(m_size < capacity);
+        m_words[m_size++] = w;
+    }
+    void trim() {
+        while (m_size && !m_words[m_size-1]) --m_size;
+    }
+
+    uint32_t m_words[capacity];
+    int m_size;
+};
+
+// this routine assumes valid input sequence (checked by re2c rules)
+template <typename Float>
+bool readDecimalFloat(const SRef& s, Float& res)
+{
+    typedef IEEE754Traits<Float> Traits;
+    const char * const end = s.end;
+    const char *p = s.begin;
+
+    typename Traits::RawBitsType sign = 0;
+    if (*p == '-' || *p == '+') {
+        if (*p == '-') sign = Traits::signMask;
+        ++p;
+    }
+
+    // value is D * 10^exp10 with D made of the digits from firstSig to lastSig
+    const char *firstSig = 0, *lastSig = 0, *dot = 0;
+    for(; p != end && (*p | 0x20) != 'e'; ++p) {
+        if (*p == '.') {
+            dot = p;
+        } else if (*p != '0') {
+            if (!firstSig) firstSig = p;
+            lastSig = p;
+        }
+    }
+    if (!firstSig) {
+        res = Float::fromRawBits(sign); // signed zero
+        return true;
+    }
+    const char* const intEnd = dot ? dot : p;
+    int64_t exp10 = lastSig < intEnd ? intEnd - lastSig - 1 : -(lastSig - intEnd);
+    int numDigits = static_cast<int>(lastSig - firstSig + 1) - (firstSig < intEnd && intEnd < lastSig ? 1 : 0);
+
+    if (p != end) {
+        ++p;
+        bool const negExp = *p == '-';
+        if (*p == '-' || *p == '+') ++p;
+        int64_t exp = 0;
+        for(; p != end; ++p) {
+            if (exp < 100000000) exp = exp * 10 + (*p - '0'); // saturate, out of range anyway
+        }
+        exp10 += negExp ? -exp : exp;
+    }
+
+    // D * 10^exp10 is at least 10^(numDigits-1+exp10) and less than 10^(numDigits+exp10)
+    if (numDigits + exp10 > 309) return false;
+    if (numDigits + exp10 < -324) {
+        res = Float::fromRawBits(sign); // below half of the smallest double denormal
+        return true;
+    }
+
+    // no halfway point between two doubles needs more than 768 significant digits,
+    // dropped tail always holds lastSig so it is nonzero: replace it with a single '1'
+    int const maxDigits = 800;
+    bool const truncated = numDigits > maxDigits;
+    if (truncated) {
+        exp10 += numDigits - maxDigits - 1;
+        numDigits = maxDigits;
+    }
+
+    BigUInt num;
+    uint32_t chunk = 0;
+    int chunkLen = 0;
+    for(int i = 0; i < numDigits; ++firstSig) {
+        if (*firstSig == '.') continue;
+        chunk = chunk * 10 + (*firstSig - '0');
+        ++i;
+        if (++chunkLen == 9 || i == numDigits) {
+            num.mulPow10(chunkLen);
+            num.mulAdd(1, chunk);
+            chunk = 0;
+            chunkLen = 0;
+        }
+    }
+    if (truncated) {
+        num.mulAdd(10, 1);
+        ++numDigits;
+    }
+
+    int const precision = Traits::mntsWidth + 1;
+    int exp2;
+    uint64_t m;
+    bool sticky;
+    if (exp10 >= 0) {
+        num.mulPow10(static_cast<int>(exp10));
+        int const len = num.bitLength();
+        exp2 = len > 64 ? len - 64 : 0;
+        m = num.bitsFrom(exp2);
+        sticky = num.anyBitBelow(exp2);
+    } else {
+        // quotient of 2 or 3 bits more than needed for rounding, remainder goes to sticky
+        BigUInt den(1);
+        den.mulPow10(static_cast<int>(-exp10));
+        exp2 = precision + 2 + den.bitLength() - num.bitLength();
+        if (exp2 > 0) {
+            num.shiftLeft(exp2);
         } else {
-            int const digit = digitValue(tolower(*p++));
-            mntsBits = digit;
-            int const digBitLen = digitValueBitLen(digit);
-            bitCount += digBitLen;
-            expShift += digBitLen;
-
-            // read mantissa before dot
-            while (tolower(*p)!='p' && *p!='.' && bitCount < maxBits) {
-                int const digit = digitValue(*p);
-                mntsBits = (mntsBits << 4) | digit;
-                bitCount += 4;
-                expShift += 4;
-                ++p;
-            }
-            // if we ran out of mantissa need to skip until dot shifting exponent
-            while (tolower(*p)!='p' && *p!='.') expShift +=4 , ++p;
-            if (*p=='.') ++p;
+            den.shiftLeft(-exp2);
         }
+        exp2 = -exp2;
+
+        uint64_t qHi;
+        m = num.divide(den, qHi);
+        assert(qHi == 0);
+        sticky = !num.isZero();
+    }
+
+    res = roundToFloat<Float>(sign, m, exp2, sticky);
+    return (res.rawBits() & ~Traits::signMask) != Traits::expMask;
+}
+
+// Shortest round-trip decimal conversion is the Ryu algorithm (Ulf Adams,
+// "Ryu: fast float-to-string conversion", PLDI 2018). Its 128-bit power of 5
+// tables are made once from exact big integers instead of being spelled out.
 
-        // after dot
-        while (tolower(*p)!='p' && bitCount < maxBits) { // read the rest of mantissa
-            int const digit = digitValue(*p);
-            mntsBits = (mntsBits << 4) | digit;
-            bitCount += 4;
-            ++p;
+static const int pow5BitCount    = 125;
+static const int pow5InvBitCount = 125;
+
+struct Pow5Tables
+{
+    static const int splitSize    = 326;
+    static const int invSplitSize = 342;
+
+    uint64_t split[splitSize][2];       // top bits of 5^i
+    uint64_t invSplit[invSplitSize][2]; // 2^(bitlength(5^i)-1+pow5InvBitCount) / 5^i, rounded up
+
+    Pow5Tables() {
+        BigUInt pow5(1);
+        for(int i = 0; i < invSplitSize; ++i, pow5.mulAdd(5, 0)) {
+            int const len = pow5.bitLength();
+            if (i < splitSize) {
+                BigUInt top = pow5;
+                int lo = len - pow5BitCount;
+                if (lo < 0) {
+                    top.shiftLeft(-lo);
+                    lo = 0;
+                }
+                split[i][0] = top.bitsFrom(lo);
+                split[i][1] = top.bitsFrom(lo + 64);
+            }
+            BigUInt num(1);
+            num.shiftLeft(len - 1 + pow5InvBitCount);
+            uint64_t qHi;
+            uint64_t const q = num.divide(pow5, qHi);
+            invSplit[i][0] = q + 1;
+            invSplit[i][1] = qHi + (q + 1 == 0 ? 1 : 0);
         }
+    }
+};
+
+static const Pow5Tables& pow5Tables()
+{
+    static const Pow5Tables tables;
+    return tables;
+}
+
+static inline int pow5bits(int e)     { return static_cast<int>((static_cast<uint32_t>(e) * 1217359) >> 19) + 1; }
+static inline int log10Pow2(int e)    { return static_cast<int>((static_cast<uint32_t>(e) * 78913) >> 18); }
+static inline int log10Pow5(int e)    { return static_cast<int>((static_cast<uint32_t>(e) * 732923) >> 20); }
+
+static inline bool multipleOfPowerOf5(uint64_t v, int p)
+{
+    int count = 0;
+    for(; v % 5 == 0; v /= 5) ++count;
+    return count >= p;
+}
+
+static inline bool multipleOfPowerOf2(uint64_t v, int p)
+{
+    return (v & ((static_cast<uint64_t>(1) << p) - 1)) == 0;
+}
 
-        if (mntsBits) {
-            while (tolower(*p)!='p') ++p; // skip the rest of digits until 'p'
+static inline uint64_t umul128(uint64_t a, uint64_t b, uint64_t& productHi)
+{
+    uint64_t const aLo = static_cast<uint32_t>(a), aHi = a >> 32;
+    uint64_t const bLo = static_cast<uint32_t>(b), bHi = b >> 32;
+    uint64_t const b00 = aLo * bLo, b01 = aLo * bHi, b10 = aHi * bLo, b11 = aHi * bHi;
+    uint64_t const mid1 = b10 + (b00 >> 32);
+    uint64_t const mid2 = b01 + static_cast<uint32_t>(mid1);
+    productHi = b11 + (mid1 >> 32) + (mid2 >> 32);
+    return (mid2 << 32) | static_cast<uint32_t>(b00);
+}
 
-            ++p;
-            istringstreamalert(p,(unsigned)(end-p)) >> std::dec >> exp;  // read decimal exponent
-            exp += expShift - 1;
+/// (m * mul) >> j for a 128-bit mul and 64 < j < 128
+static inline uint64_t mulShift64(uint64_t m, const uint64_t* mul, int j)
+{
+    uint64_t high0, high1;
+    umul128(m, mul[0], high0);
+    uint64_t const low1 = umul128(m, mul[1], high1);
+    uint64_t const sum = high0 + low1;
+    if (sum < high0) ++high1;
+    int const dist = j - 64;
+    assert(dist > 0 && dist < 64);
+    return (high1 << (64 - dist)) | (sum >> dist);
+}
 
-            if (bitCount > maxBits) {
-                mntsBits >>= bitCount-maxBits; // shift back to fit max mantissa len
+/// Shortest digits that read back as the finite nonzero value with the given
+/// bits, closest to it when there is a choice: the value is the result times
+/// 10^exp10.
+template <typename Float>
+static uint64_t shortestDecimal(typename IEEE754Traits<Float>::RawBitsType bits, int& exp10)
+{
+    typedef IEEE754Traits<Float> Traits;
+    const Pow5Tables& tables = pow5Tables();
+
+    uint64_t const ieeeMnts = bits & Traits::mntsMask;
+    int const ieeeExp = static_cast<int>((bits & Traits::expMask) >> Traits::mntsWidth);
+
+    // the value is m2 * 2^e2, the extra factor of 4 leaves room for the halfway points
+    int const e2 = (ieeeExp ? ieeeExp : 1) - Traits::expBias - Traits::mntsWidth - 2;
+    uint64_t const m2 = ieeeExp ? (static_cast<uint64_t>(1) << Traits::mntsWidth) | ieeeMnts : ieeeMnts;
+    bool const acceptBounds = (m2 & 1) == 0; // halfway points round to even
+    uint64_t const mv = 4 * m2;
+    unsigned const mmShift = ieeeMnts != 0 || ieeeExp <= 1; // lower neighbour is closer at powers of 2
+
+    // vr, vp and vm: the value and the bounds of its rounding interval, scaled by 10^-e10
+    uint64_t vr, vp, vm;
+    int e10;
+    bool vmIsTrailingZeros = false, vrIsTrailingZeros = false;
+    if (e2 >= 0) {
+        int const q = log10Pow2(e2) - (e2 > 3);
+        e10 = q;
+        int const j = -e2 + q + pow5InvBitCount + pow5bits(q) - 1;
+        vr = mulShift64(mv,               tables.invSplit[q], j);
+        vp = mulShift64(mv + 2,           tables.invSplit[q], j);
+        vm = mulShift64(mv - 1 - mmShift, tables.invSplit[q], j);
+        if (q <= 21) {
+            if (mv % 5 == 0) {
+                vrIsTrailingZeros = multipleOfPowerOf5(mv, q);
+            } else if (acceptBounds) {
+                vmIsTrailingZeros = multipleOfPowerOf5(mv - 1 - mmShift, q);
+            } else if (multipleOfPowerOf5(mv + 2, q)) {
+                --vp;
+            }
+        }
+    } else {
+        int const q = log10Pow5(-e2) - (-e2 > 1);
+        e10 = q + e2;
+        int const i = -e2 - q;
+        int const j = q - (pow5bits(i) - pow5BitCount);
+        vr = mulShift64(mv,               tables.split[i], j);
+        vp = mulShift64(mv + 2,           tables.split[i], j);
+        vm = mulShift64(mv - 1 - mmShift, tables.split[i], j);
+        if (q <= 1) {
+            vrIsTrailingZeros = true;
+            if (acceptBounds) {
+                vmIsTrailingZeros = mmShift == 1;
             } else {
-                mntsBits <<= maxBits-bitCount; // shift forward to normalize mantissa
+                --vp;
+            }
+        } else if (q < 63) {
+            vrIsTrailingZeros = multipleOfPowerOf2(mv, q);
+        }
+    }
+
+    // drop digits while the bounds still differ
+    int removed = 0;
+    unsigned lastRemovedDigit = 0;
+    uint64_t output;
+    if (vmIsTrailingZeros || vrIsTrailingZeros) {
+        for(; vp / 10 > vm / 10; ++removed) {
+            vmIsTrailingZeros &= vm % 10 == 0;
+            vrIsTrailingZeros &= lastRemovedDigit == 0;
+            lastRemovedDigit = static_cast<unsigned>(vr % 10);
+            vr /= 10; vp /= 10; vm /= 10;
+        }
+        if (vmIsTrailingZeros) {
+            for(; vm % 10 == 0; ++removed) {
+                vrIsTrailingZeros &= lastRemovedDigit == 0;
+                lastRemovedDigit = static_cast<unsigned>(vr % 10);
+                vr /= 10; vp /= 10; vm /= 10;
             }
         }
+        if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0) {
+            lastRemovedDigit = 4; // exactly halfway, round to even
+        }
+        output = vr + (((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || lastRemovedDigit >= 5) ? 1 : 0);
+    } else {
+        bool roundUp = false;
+        for(; vp / 10 > vm / 10; ++removed) {
+            roundUp = vr % 10 >= 5;
+            vr /= 10; vp /= 10; vm /= 10;
+        }
+        output = vr + ((vr == vm || roundUp) ? 1 : 0);
     }
+    exp10 = e10 + removed;
+    return output;
+}
+
+template <typename Float>
+unsigned toDecimalChars(Float v, char* buf)
+{
+    typedef IEEE754Traits<Float> Traits;
+
+    typename Traits::RawBitsType const srcBits = v.rawBits();
+    char* p = buf;
 
-    if (!mntsBits) {
-        return *reinterpret_cast<const Float*>(&sign);
+    if (srcBits & Traits::signMask) {
+        *p++ = '-';
     }
 
-    if (exp >= Traits::maxExp) {
-        typename Traits::RawBitsType const res = (sign | Traits::expMask); // Signed Inf
-        return *reinterpret_cast<const Float*>(&res);
-    } else if (exp <= Traits::minExp) {
-        int const denormShift = Traits::minExp - exp;
-        if ( denormShift > Traits::mntsWidth ) { // mantissa shifted all the way off
-            return *reinterpret_cast<const Float*>(&sign); // signed zero
+    if( (srcBits & ~Traits::signMask) == 0 ) {
+        *p++ = '0'; *p++ = '.'; *p++ = '0';
+        return static_cast<unsigned>(printSuffix(p, Traits::suffix) - buf);
+    }
+    assert((srcBits & Traits::expMask) != Traits::expMask);
+
+    int exp10;
+    uint64_t value = shortestDecimal<Float>(srcBits, exp10);
+    char digits[20];
+    int numDigits = 0;
+    for(; value; value /= 10) {
+        digits[sizeof digits - ++numDigits] = static_cast<char>('0' + value % 10);
+    }
+    const char* const first = digits + sizeof digits - numDigits;
+
+    // plain notation unless it needs more than a few zeroes around the digits,
+    // a dot or an exponent is always there to keep the literal a float one
+    int const maxPadding = 5;
+    int const point = numDigits + exp10; // digits before the decimal point
+    if (point >= numDigits && point - numDigits <= maxPadding) {
+        p = std::copy(first, first + numDigits, p);
+        p = std::fill_n(p, point - numDigits, '0');
+        *p++ = '.'; *p++ = '0';
+    } else if (point > 0 && point < numDigits) {
+        p = std::copy(first, first + point, p);
+        *p++ = '.';
+        p = std::copy(first + point, first + numDigits, p);
+    } else if (point <= 0 && -point <= maxPadding) {
+        *p++ = '0'; *p++ = '.';
+        p = std::fill_n(p, -point, '0');
+        p = std::copy(first, first + numDigits, p);
+    } else {
+        *p++ = *first;
+        if (numDigits > 1) {
+            *p++ = '.';
+            p = std::copy(first + 1, first + numDigits, p);
         }
-        exp = Traits::minExp;
-        mntsBits >>= denormShift; // shifting denormalized mantissa
+        *p++ = 'e';
+        if (point > 0) *p++ = '+';
+        p = printDecimal(p, point - 1);
     }
-
-    return makeFloat<Float>(sign,exp,mntsBits);
+    return static_cast<unsigned>(printSuffix(p, Traits::suffix) - buf);
 }
 
 using ::ldexp; // to include ldexp from global namespace
@@ -333,8 +817,8 @@ int testc99(std::ostream& err)
         for (unsigned i=0; i<(sizeof m/sizeof m[0]); ++i) {
             Float const v = ldexp(m[i],e);
             std::string r = toC99str(v);
-            Float const res = readC99<Float>(SRef(&r[0],&r[0] + r.length()));
-            if (res!=v) {
+            Float res;
+            if (!readC99<Float>(SRef(&r[0],&r[0] + r.length()), res) || res!=v) {
                 ++errors;
                 err << "C99 test failed on e=" << e << ", value=" << v.floatValue() << std::endl;
             }
@@ -379,9 +863,21 @@ template std::string toC99str(f16_t v);
 template std::string toC99str(f32_t v);
 template std::string toC99str(f64_t v);
 
-template f16_t  readC99(const SRef& s);
-template f32_t  readC99(const SRef& s);
-template f64_t  readC99(const SRef& s);
+template unsigned toC99Chars(f16_t v, char* buf);
+template unsigned toC99Chars(f32_t v, char* buf);
+template unsigned toC99Chars(f64_t v, char* buf);
+
+template unsigned toDecimalChars(f16_t v, char* buf);
+template unsigned toDecimalChars(f32_t v, char* buf);
+template unsigned toDecimalChars(f64_t v, char* buf);
+
+template bool readC99(const SRef& s, f16_t& res);
+template bool readC99(const SRef& s, f32_t& res);
+template bool readC99(const SRef& s, f64_t& res);
+
+template bool readDecimalFloat(const SRef& s, f16_t& res);
+template bool readDecimalFloat(const SRef& s, f32_t& res);
+template bool readDecimalFloat(const SRef& s, f64_t& res);
 
 int testFloatRelatedCode(std::ostream& err) {
      return testc99<f64_t>(err)
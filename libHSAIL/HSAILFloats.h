@@ -190,10 +190,31 @@ template <> struct value_class<f16_t>  : float_class {};
 template <typename Float>
 std::string toC99str(Float v);
 
+/// Longest text written by toC99Chars and toDecimalChars.
+const unsigned maxFloatCharsLength = 32;
+
+/// Writes v as a C99 hexadecimal float literal with its type suffix, returns
+/// the length. The text is not terminated.
+template <typename Float>
+unsigned toC99Chars(Float v, char* buf);
+
+/// Writes finite v as the shortest decimal float literal (with its type
+/// suffix) that reads back to the same bits, returns the length. The text is
+/// not terminated.
+template <typename Float>
+unsigned toDecimalChars(Float v, char* buf);
+
 struct SRef;
 
+/// Converts a C99 hexadecimal float literal (as matched by the scanner) to the
+/// nearest Float, ties to even. Returns false if the exponent does not fit int.
+template <typename Float>
+bool readC99(const SRef& s, Float& res);
+
+/// Converts a decimal float literal without suffix to the nearest Float, ties
+/// to even. Returns false if the value is too large to be represented.
 template <typename Float>
-Float readC99(const SRef& s);
+bool readDecimalFloat(const SRef& s, Float& res);
 
 template <typename Float> struct IEEE754BasicTraits;
 
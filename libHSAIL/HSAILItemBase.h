@@ -127,7 +127,7 @@ public:
     }
 
     /// access to the actual offset that reference the string.
-    Offset& deref() { return *m_refSection->getData<Offset>(m_offset2Ref); }
+    Offset& deref() { return *m_refSection->getWritableData<Offset>(m_offset2Ref); }
     Offset deref() const { return *m_refSection->getData<Offset>(m_offset2Ref); }
 
     /// @name assignment operator. This operator actually adds string to the string section
@@ -202,8 +202,14 @@ public:
     {
     }
 
+    /// section containing item with reference.
+    BrigSectionImpl* refSection() const { return m_refSection; }
+
+    /// offset of the field holding the reference in refSection.
+    Offset offset2Ref() const { return m_offset2Ref; }
+
     /// access to the actual offset that reference the Item.
-    Offset& deref() { return *m_refSection->getData<Offset>(m_offset2Ref); }
+    Offset& deref() { return *m_refSection->getWritableData<Offset>(m_offset2Ref); }
     Offset deref() const { return *m_refSection->getData<Offset>(m_offset2Ref); }
 
     /// assignment operator. Assign reference to another brig item.
@@ -237,7 +243,7 @@ public:
     /// @name set accessors.
     /// @{
     ValRef& operator=(T rhs) {
-        *m_refSection->getData<T>(m_valOffset) = rhs;
+        *m_refSection->getWritableData<T>(m_valOffset) = rhs;
         return *this;
     }
     ValRef& operator=(const ValRef& rhs) {
@@ -305,7 +311,7 @@ public:
     }
 
     BFValRef& operator=(T rhs) {
-	    BitsT &v = *m_refSection->getData<BitsT>(m_valOffset);
+	    BitsT &v = *m_refSection->getWritableData<BitsT>(m_valOffset);
 	    v &= ~shiftedMask;
 	    v |= (static_cast<BitsT>(rhs) & mask) << firstBit;
         return *this;
@@ -398,16 +404,31 @@ public:
         assert(refSection);
     }
 
+    /// section containing item with reference.
+    BrigSectionImpl* refSection() const { return m_refSection; }
+
+    /// offset of the field holding the reference in refSection.
+    Offset offset2Ref() const { return m_offset2Ref; }
+
     /// access to the actual offset that reference the string.
-    Offset& deref() { return *m_refSection->getData<Offset>(m_offset2Ref); }
+    Offset& deref() { return *m_refSection->getWritableData<Offset>(m_offset2Ref); }
     Offset deref() const { return *m_refSection->getData<Offset>(m_offset2Ref); }
 
-    /// @name assignment operator. This operator actually adds string to the string section
-    /// and make this reference point to it.
+    /// @name assignment operator. This operator actually adds list to the string section
+    /// and make this reference point to it. Lists are immutable and shared by
+    /// all references to the same contents.
     /// @{
     ListRef& operator=(const ItemList& list) {
       assert(list.section() == 0 || list.section() == &m_refSection->container()->sectionById(Item::SECTION));
-      deref() = m_refSection->container()->strings().addStringImpl(list.data());
+      deref() = m_refSection->container()->strings().addString(list.data());
+      return *this;
+    }
+
+    /// make this reference point to a new copy of list which is not shared
+    /// with other references so that elements can be updated using writeAccess.
+    ListRef& assignUnshared(const ItemList& list) {
+      assert(list.section() == 0 || list.section() == &m_refSection->container()->sectionById(Item::SECTION));
+      deref() = m_refSection->container()->strings().addUnshared(list.data());
       return *this;
     }
 
@@ -437,6 +458,8 @@ public:
       }
     }
 
+    /// access to list element for update. The list should be an unshared
+    /// one, see assignUnshared.
     ItemRef<Item> writeAccess(int index) {
       SRef theData = data();
       int length = (int)data().length();
@@ -589,8 +612,8 @@ public:
     void annotate(const SourceInfo& si) {
         m_section->annotate(*this,si);
     }
-    /// return associated SourceInfo. May be NULL.
-    const SourceInfo* srcInfo() const {
+    /// return associated SourceInfo. Its line is -1 if there is none.
+    SourceInfo srcInfo() const {
         return m_section->sourceInfo(brigOffset());
     }
 };
@@ -573,6 +573,7 @@ void Parser::parseProgram()
     m_bw.startProgram();
 
     while (peek().kind()!=EEndOfSource) {
+        m_scanner.releaseConsumed();
         parseTopLevelStatement();
     }
     m_bw.endProgram();
@@ -691,6 +692,7 @@ int Parser::parseCodeBlock()
 
     int numInsts = 0;
     while (!tryEatToken(ERCurl)) {
+        m_scanner.releaseConsumed();
         numInsts += parseBodyStatement();
     }
 
@@ -742,6 +744,7 @@ int Parser::parseArgScope()
 
     int numInsts = 0;
     while (peek().kind()!=ERCurl) {
+        m_scanner.releaseConsumed();
         numInsts += parseBodyStatement();
     };
 
@@ -1301,7 +1304,8 @@ Inst Parser::parseExtInst()
 void Parser::checkVxIsValid(int vx, Operand o)
 {
   // check whether modifier v2/v3/v4 corresponds to 1st operand
-  const SourceInfo* const srcInfo = o.srcInfo();
+  SourceInfo const si = o ? o.srcInfo() : SourceInfo();
+  const SourceInfo* const srcInfo = si.line != -1 ? &si : NULL;
 
   assert(vx > 0);
   if (vx == 1) {
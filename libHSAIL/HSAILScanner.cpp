@@ -46,42 +46,307 @@
 #include <limits>
 #include <utility>
 
-StreamScannerBase::StreamScannerBase(std::istream& is)
-    : m_end(0)
-    , m_is(is)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HSAIL_SCAN_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// AVX2 code is only built where it can be enabled per function
+#if defined(HSAIL_SCAN_SSE2) && (defined(__clang__) || \
+    (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define HSAIL_SCAN_AVX2 1
+#include <immintrin.h>
+#endif
+
+StreamScannerBase::StreamScannerBase(std::istream& is, size_t windowSize)
+    : m_begin(0)
+    , m_end(0)
+    , m_is(&is)
+    , m_bufferPos(0)
+    , m_bufferLine(0)
+    , m_lineStarts(1, 0)
+    , m_windowSize(windowSize)
+    , m_eof(false)
 {
     readBuffer();
 }
 
+StreamScannerBase::StreamScannerBase(const char* text, size_t length)
+    : m_begin(text)
+    , m_end(text)
+    , m_is(0)
+    , m_bufferPos(0)
+    , m_bufferLine(0)
+    , m_lineStarts(1, 0)
+    , m_windowSize(0)
+    , m_eof(true)
+{
+    if (length != 0 && text[length - 1] == 0) {
+        m_end = text + length - 1;
+    } else {
+        m_buffer.reserve(length + 1);
+        m_buffer.assign(text, text + length);
+        m_buffer.push_back(0);
+        m_begin = &m_buffer[0];
+        m_end = m_begin + length;
+    }
+}
+
 void StreamScannerBase::readChars(int )
 {
 }
 
 void StreamScannerBase::readBuffer()
 {
-    m_buffer.clear();
-    m_is.clear();
-    m_is.seekg (0, std::ios::end);
-    std::streamoff const length = m_is.tellg();
-    m_is.seekg (0, std::ios::beg);
+    m_buffer.assign(1, 0);
+    m_begin = m_end = &m_buffer[0];
+    m_is->clear();
+
+    if (m_windowSize) {
+        fillWindow(0);
+        return;
+    }
 
-    if (length < 0) { return; }
+    m_is->seekg (0, std::ios::end);
+    std::streamoff const length = m_is->tellg();
+    m_is->seekg (0, std::ios::beg);
 
-    m_buffer.resize((BufferContainer::size_type)(length+1));
-    m_end = &m_buffer[0];
+    if (length < 0) {
+        // pipe or terminal, read until the end growing the buffer
+        m_is->clear();
+        while (readChunk(std::max<size_t>(m_buffer.size(), 4096)) != 0) { }
+        return;
+    }
+    readChunk(static_cast<size_t>(length));
+    m_eof = true;
+}
 
-    m_is.read(&m_buffer[0],length);
-    unsigned n = (unsigned)m_is.gcount();
-    m_end += static_cast<ptrdiff_t>(n);
-    m_buffer[n] = 0;
+// append up to numBytes read from the stream to the text
+size_t StreamScannerBase::readChunk(size_t numBytes)
+{
+    size_t const size = m_buffer.size() - 1;
+    m_buffer.resize(size + numBytes + 1);
+    m_is->read(&m_buffer[size], static_cast<std::streamsize>(numBytes));
+    size_t const n = static_cast<size_t>(m_is->gcount());
+    if (n < numBytes) { m_eof = true; }
+    m_buffer.resize(size + n + 1);
+    m_buffer[size + n] = 0;
+    m_begin = &m_buffer[0];
+    m_end = m_begin + size + n;
+    return n;
+}
+
+// Drop the text before the line containing keepPos and read at least
+// m_windowSize more bytes and then up to the end of line, so that no token
+// (except embedded text) is split between windows. The previous buffer is
+// retired rather than freed as the parser may still hold references into it.
+bool StreamScannerBase::fillWindow(std::streamoff keepPos)
+{
+    if (m_eof) { return false; }
+
+    const char* const text = m_begin;
+    const char* keepLine = ptrAt(keepPos);
+    while (keepLine > text && keepLine[-1] != '\n') { --keepLine; }
+    size_t const numKept = static_cast<size_t>(m_end - keepLine);
+
+    BufferContainer buffer;
+    buffer.reserve(numKept + std::max(m_windowSize, numKept) + 1);
+    buffer.assign(keepLine, m_end + 1);
+    m_bufferPos = streamPosAt(keepLine);
+    // keepPos comes from a token, so its line has been reached by the scanner
+    std::vector<std::streamoff>::iterator const keepIdx =
+        std::lower_bound(m_lineStarts.begin(), m_lineStarts.end(), m_bufferPos);
+    assert(keepIdx != m_lineStarts.end() && *keepIdx == m_bufferPos);
+    m_bufferLine += static_cast<int>(keepIdx - m_lineStarts.begin());
+    m_lineStarts.erase(m_lineStarts.begin(), keepIdx);
+    if (text != m_end) { m_retired.push_back(BufferContainer()); m_retired.back().swap(m_buffer); }
+    m_buffer.swap(buffer);
+
+    size_t n = readChunk(std::max(m_windowSize, numKept));
+    while (!m_eof && m_end[-1] != '\n') {
+        n += readChunk(1);
+    }
+    return n != 0;
 }
 
 std::streamoff StreamScannerBase::streamPosAt(const char *from) const
 {
-    if (m_buffer.empty()) {
-        return 0;
+    return m_bufferPos + static_cast<std::streamoff>(from - m_begin);
+}
+
+const char* StreamScannerBase::ptrAt(std::streamoff pos) const
+{
+    assert(pos >= m_bufferPos && pos - m_bufferPos <= m_end - m_begin);
+    return m_begin + static_cast<ptrdiff_t>(pos - m_bufferPos);
+}
+
+void StreamScannerBase::addLineStart(int line, std::streamoff pos)
+{
+    // a line may be passed again when a token is rescanned
+    if (line == m_bufferLine + static_cast<int>(m_lineStarts.size())) {
+        m_lineStarts.push_back(pos);
     }
-    return static_cast<std::streamoff>(from - &m_buffer[0]);
+}
+
+namespace {
+
+typedef const char* (*ScanFunc)(const char* p, const char* end);
+
+struct ScanKernels {
+    ScanFunc skipBlanks;
+    ScanFunc findLineEnd;
+    ScanFunc findCommentStop;
+    ScanFunc findEmbeddedTextStop;
+};
+
+// With Skip the scan stops at the first character that is none of C0..C3,
+// otherwise at the first one that is any of them.
+template <bool Skip, char C0, char C1, char C2, char C3>
+const char* scanScalar(const char* p, const char* end)
+{
+    for(; p != end; ++p) {
+        char const c = *p;
+        if ((c == C0 || c == C1 || c == C2 || c == C3) != Skip) { break; }
+    }
+    return p;
+}
+
+#ifdef HSAIL_SCAN_SSE2
+
+inline unsigned firstSetBit(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return idx;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+template <bool Skip, char C0, char C1, char C2, char C3>
+const char* scanSSE2(const char* p, const char* end)
+{
+    __m128i const c0 = _mm_set1_epi8(C0), c1 = _mm_set1_epi8(C1);
+    __m128i const c2 = _mm_set1_epi8(C2), c3 = _mm_set1_epi8(C3);
+    for(; end - p >= 16; p += 16) {
+        __m128i const v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i const hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, c0), _mm_cmpeq_epi8(v, c1)),
+                                         _mm_or_si128(_mm_cmpeq_epi8(v, c2), _mm_cmpeq_epi8(v, c3)));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+        if (Skip) { mask ^= 0xFFFF; }
+        if (mask) { return p + firstSetBit(mask); }
+    }
+    return scanScalar<Skip,C0,C1,C2,C3>(p, end);
+}
+
+#endif
+
+#ifdef HSAIL_SCAN_AVX2
+
+template <bool Skip, char C0, char C1, char C2, char C3>
+__attribute__((target("avx2")))
+const char* scanAVX2(const char* p, const char* end)
+{
+    __m256i const c0 = _mm256_set1_epi8(C0), c1 = _mm256_set1_epi8(C1);
+    __m256i const c2 = _mm256_set1_epi8(C2), c3 = _mm256_set1_epi8(C3);
+    for(; end - p >= 32; p += 32) {
+        __m256i const v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i const hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, c0), _mm256_cmpeq_epi8(v, c1)),
+                                            _mm256_or_si256(_mm256_cmpeq_epi8(v, c2), _mm256_cmpeq_epi8(v, c3)));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (Skip) { mask = ~mask; }
+        if (mask) { return p + firstSetBit(mask); }
+    }
+    return scanSSE2<Skip,C0,C1,C2,C3>(p, end);
+}
+
+#endif
+
+#define HSAIL_SCAN_KERNELS(impl) { \
+    &impl<true,  ' ', '\t', '\n', ' '>, \
+    &impl<false, '\r', '\n', '\0', '\0'>, \
+    &impl<false, '*', '\r', '\n', '\0'>, \
+    &impl<false, '#', '\r', '\n', '\0'> }
+
+bool getScanKernels(StreamScannerBase::ScanImpl impl, ScanKernels& res)
+{
+    switch(impl) {
+    case StreamScannerBase::SCAN_SCALAR: {
+        ScanKernels const k = HSAIL_SCAN_KERNELS(scanScalar);
+        res = k;
+        return true;
+    }
+#ifdef HSAIL_SCAN_SSE2
+    case StreamScannerBase::SCAN_SSE2: {
+        ScanKernels const k = HSAIL_SCAN_KERNELS(scanSSE2);
+        res = k;
+        return true;
+    }
+#endif
+#ifdef HSAIL_SCAN_AVX2
+    case StreamScannerBase::SCAN_AVX2: {
+        __builtin_cpu_init();
+        if (!__builtin_cpu_supports("avx2")) { return false; }
+        ScanKernels const k = HSAIL_SCAN_KERNELS(scanAVX2);
+        res = k;
+        return true;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+#undef HSAIL_SCAN_KERNELS
+
+ScanKernels selectScanKernels()
+{
+    ScanKernels k;
+    if (!getScanKernels(StreamScannerBase::SCAN_AVX2, k) &&
+        !getScanKernels(StreamScannerBase::SCAN_SSE2, k)) {
+        getScanKernels(StreamScannerBase::SCAN_SCALAR, k);
+    }
+    return k;
+}
+
+ScanKernels& scanKernels()
+{
+    static ScanKernels kernels = selectScanKernels();
+    return kernels;
+}
+
+} // end namespace
+
+bool StreamScannerBase::selectScanImpl(ScanImpl impl)
+{
+    ScanKernels k;
+    if (!getScanKernels(impl, k)) { return false; }
+    scanKernels() = k;
+    return true;
+}
+
+const char* StreamScannerBase::skipBlanks(const char* p, const char* end)
+{
+    return scanKernels().skipBlanks(p, end);
+}
+
+const char* StreamScannerBase::findLineEnd(const char* p, const char* end)
+{
+    return scanKernels().findLineEnd(p, end);
+}
+
+const char* StreamScannerBase::findCommentStop(const char* p, const char* end)
+{
+    return scanKernels().findCommentStop(p, end);
+}
+
+const char* StreamScannerBase::findEmbeddedTextStop(const char* p, const char* end)
+{
+    return scanKernels().findEmbeddedTextStop(p, end);
 }
 
 void chop(std::string& str)
@@ -127,10 +392,45 @@ std::pair<std::string,unsigned> getContextString(std::istream& is, const SrcLoc&
     return res;
 }
 
+// same as the above but for the text retained by the scanner
+std::pair<std::string,unsigned> StreamScannerBase::getContextString(const SrcLoc& srcLoc) const
+{
+    using namespace std;
+    pair<string,unsigned> res(string(), 0);
+    if (srcLoc.line < m_bufferLine) { return res; }
+
+    // lines past the last one reached by the scanner are counted from it
+    int const lastIndexed = m_bufferLine + static_cast<int>(m_lineStarts.size()) - 1;
+    const char* p = ptrAt(m_lineStarts[min(srcLoc.line, lastIndexed) - m_bufferLine]);
+    for(int lineNum = lastIndexed; lineNum < srcLoc.line; ++lineNum) {
+        p = find(p, m_end, '\n');
+        if (p == m_end) { return res; }
+        ++p;
+    }
+
+    int const lineLen = 80;
+    if (srcLoc.column < lineLen) {
+        res.second = srcLoc.column;
+    } else {
+        int const pfxLen = lineLen/2;
+        p += min<ptrdiff_t>(srcLoc.column - pfxLen, m_end - p);
+        res.second = pfxLen;
+    }
+
+    const char* const e = find(p, p + min<ptrdiff_t>(lineLen, m_end - p), '\n');
+    res.first.assign(p, e);
+    chop(res.first);
+    return res;
+}
+
 void printError(std::ostream& os, std::istream& is, const SrcLoc& errLoc, const char* message)
+{
+    printError(os, getContextString(is,errLoc), errLoc, message);
+}
+
+void printError(std::ostream& os, const std::pair<std::string,unsigned>& ctxInfo, const SrcLoc& errLoc, const char* message)
 {
     using namespace std;
-    pair<string,unsigned> const ctxInfo = getContextString(is,errLoc);
     const std::string& ctxStr = ctxInfo.first;
     unsigned const ctxStrPos = ctxInfo.second;
 
@@ -143,7 +443,12 @@ void printError(std::ostream& os, std::istream& is, const SrcLoc& errLoc, const
         os << ((*i=='\t') ? '\t' : ' ');
     }
     os << '^' << endl;
-    os << "input" << '(' << errLoc.line+1 << ',' <<  errLoc.column+1 << "): " << message << endl;
+    printErrorPos(os, errLoc, message);
+}
+
+void printErrorPos(std::ostream& os, const SrcLoc& errLoc, const char* message)
+{
+    os << "input" << '(' << errLoc.line+1 << ',' <<  errLoc.column+1 << "): " << message << std::endl;
 }
 
 
@@ -159,23 +464,93 @@ public:
     }
 };
 
-Scanner::Scanner(std::istream& is, const ExtManager& extMgr, bool disableComments)
-    : StreamScannerBase(is)
+// Value of the digits of a literal token after the skip prefix characters,
+// false on overflow (where operator>> would set failbit). The scanner rules
+// have already checked that only digits of base are present.
+template <typename T>
+static bool parseDigits(const SRef& text, size_t skip, unsigned base, T& res)
+{
+    T const maxValue = std::numeric_limits<T>::max();
+    T v = 0;
+    for(const char* p = text.begin + skip; p != text.end; ++p) {
+        unsigned const c = static_cast<unsigned char>(*p);
+        unsigned const d = c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+        assert(d < base);
+        if (v > (maxValue - d) / base) { return false; }
+        v = static_cast<T>(v * base + d);
+    }
+    res = v;
+    return true;
+}
+
+Scanner::Scanner(std::istream& is, const ExtManager& extMgr, bool disableComments, size_t windowSize)
+    : StreamScannerBase(is, windowSize)
     , m_peekToken(NULL)
     , m_lineNum(0)
     , m_lineStart(0)
+    , m_peekLineNum(0)
+    , m_peekLineStart(0)
+    , m_releasedPos(0)
     , m_disableComments(disableComments)
     , m_extMgr(extMgr)
 {
+    initTokens();
+}
+
+Scanner::Scanner(const char* text, size_t length, const ExtManager& extMgr, bool disableComments)
+    : StreamScannerBase(text, length)
+    , m_peekToken(NULL)
+    , m_lineNum(0)
+    , m_lineStart(0)
+    , m_peekLineNum(0)
+    , m_peekLineStart(0)
+    , m_releasedPos(0)
+    , m_disableComments(disableComments)
+    , m_extMgr(extMgr)
+{
+    initTokens();
+}
 
-    m_pool[0].m_scanner = this;
-    m_pool[1].m_scanner = this;
+void Scanner::initTokens()
+{
+    for(int i = 0; i < 2; ++i) {
+        Token &t = m_pool[i];
+        t.m_scanner = this;
+        t.m_kind = EEmpty;
+        t.m_lineStart = 0;
+        t.m_lineNum = 0;
+        t.m_text.begin = t.m_text.end = m_begin;
+    }
+    m_curToken = &m_pool[0];
+}
 
-    Token &t = m_pool[0];
-    t.m_kind = EEmpty;
-    t.m_text.begin = t.m_text.end = &m_buffer[0];
+void Scanner::releaseConsumed()
+{
+    if (!isWindowed()) { return; }
+    m_retired.clear();
+    m_releasedPos = m_peekToken ? m_peekToken->m_lineStart : m_lineStart;
+}
 
-    m_curToken = &t;
+// Read the next window when the scanner reaches the end of the current one.
+// Tokens are moved to the new buffer, text which is referenced by them or
+// not yet released is kept.
+bool Scanner::refill()
+{
+    if (!isWindowed() || m_eof) { return false; }
+    std::streamoff keepPos = m_releasedPos;
+    std::streamoff textPos[2][2];
+    for(int i = 0; i < 2; ++i) {
+        Token &t = m_pool[i];
+        keepPos = std::min(keepPos, t.m_lineStart);
+        textPos[i][0] = streamPosAt(t.m_text.begin);
+        textPos[i][1] = streamPosAt(t.m_text.end);
+    }
+    bool const res = fillWindow(keepPos);
+    for(int i = 0; i < 2; ++i) {
+        m_pool[i].m_text.begin = ptrAt(textPos[i][0]);
+        m_pool[i].m_text.end = ptrAt(textPos[i][1]);
+    }
+    return res;
 }
 
 EScanContext Scanner::getTokenContext(ETokens token)
@@ -200,6 +575,14 @@ Scanner::CToken& Scanner::peek(EScanContext ctx)
 {
     // rescan if needed
     if (m_peekToken==NULL || m_peekToken->kind()==EEmpty || getTokenContext(m_peekToken->kind()) != ctx) {
+        // lines passed while scanning the peeked token are passed again
+        if (m_peekToken==NULL) {
+            m_peekLineNum = m_lineNum;
+            m_peekLineStart = m_lineStart;
+        } else {
+            m_lineNum = m_peekLineNum;
+            m_lineStart = m_peekLineStart;
+        }
         m_peekToken = &scanNext(ctx);
     }
     return *m_peekToken;
@@ -246,6 +629,9 @@ Scanner::Token& Scanner::scanNext(EScanContext ctx)
         t.m_kind = scanModifier(/*in*/ctx, /*in/out*/t);
     } else {
         skipWhitespaces(t);
+        while (t.m_text.begin == m_end && refill()) {
+            skipWhitespaces(t);
+        }
         t.m_lineStart = m_lineStart;
         t.m_lineNum = m_lineNum;
         t.m_kind = scanDefault(/*in*/ctx, /*in/out*/t);
@@ -264,6 +650,7 @@ void Scanner::nextLine(const char *atPos)
 {
     m_lineStart = streamPosAt(atPos);
     ++m_lineNum;
+    addLineStart(m_lineNum, m_lineStart);
 }
 
 SrcLoc Scanner::srcLoc(const char* pos) const {
@@ -275,21 +662,16 @@ SrcLoc Scanner::srcLoc(const char* pos) const {
 
 uint64_t Scanner::readIntLiteral()
 {
-    using namespace std;
     uint64_t v = 0;
-
-    try {
-        switch(eatToken(EIntLiteral)) {
-        case ELitDecimal:
-            istringstreamalert(m_curToken->text()) >> dec >> v;        break;
-        case ELitOctal:
-            istringstreamalert(m_curToken->text().substr(1)) >> oct >> v; break;
-        case ELitHex:
-            istringstreamalert(m_curToken->text().substr(2)) >> hex >> v; break;
-        default:
-            assert(0);
-        }
-    } catch (const istringstream::failure&) {
+    bool ok = false;
+    switch(eatToken(EIntLiteral)) {
+    case ELitDecimal: ok = parseDigits(m_curToken->text(), 0, 10, v); break;
+    case ELitOctal:   ok = parseDigits(m_curToken->text(), 1, 8, v);  break;
+    case ELitHex:     ok = parseDigits(m_curToken->text(), 2, 16, v); break;
+    default:
+        assert(0);
+    }
+    if (!ok) {
         syntaxError("invalid literal");
     }
     return v;
@@ -297,101 +679,72 @@ uint64_t Scanner::readIntLiteral()
 
 f16_t Scanner::readF16Literal()
 {
-    using namespace std;
-
-    try {
-        switch(eatToken(EF16Literal)) {
-        case ELitDecimalWithSuffix:
-            {
-                float v;
-                istringstreamalert(m_curToken->text().rsubstr(1)) >> v;
-                return f16_t(f32_t(&v));
-            }
-        case ELitHex:
-            {
-                IEEE754Traits<f16_t>::RawBitsType v;
-                istringstreamalert(m_curToken->text().substr(2)) >> hex >> v;
-                return f16_t::fromRawBits(v);
-            }
-        case ELitC99:
-            {
-                return readC99<f16_t>(m_curToken->text());
-            }
-        default:
-            assert(0);
+    f16_t v;
+    bool ok = false;
+    switch(eatToken(EF16Literal)) {
+    case ELitDecimalWithSuffix: ok = readDecimalFloat(m_curToken->text().rsubstr(1), v); break;
+    case ELitC99:               ok = readC99(m_curToken->text(), v); break;
+    case ELitHex:
+        {
+            IEEE754Traits<f16_t>::RawBitsType bits = 0;
+            ok = parseDigits(m_curToken->text(), 2, 16, bits);
+            v = f16_t::fromRawBits(bits);
         }
-    } catch (const istringstream::failure&) {
+        break;
+    default:
+        assert(0);
+    }
+    if (!ok) {
         syntaxError("invalid literal");
     }
-    return f16_t();
+    return v;
 }
 
 f32_t Scanner::readF32Literal()
 {
-    using namespace std;
-
-    try {
-        switch(eatToken(EF32Literal)) {
-        case ELitDecimalWithSuffix:
-            {
-                float v;
-                istringstreamalert(m_curToken->text().rsubstr(1)) >> v;
-                return f32_t(&v);
-            }
-        case ELitHex:
-            {
-                IEEE754Traits<f32_t>::RawBitsType v;
-                istringstreamalert(m_curToken->text().substr(2)) >> hex >> v;
-                return f32_t::fromRawBits(v);
-            }
-        case ELitC99:
-            {
-                return readC99<f32_t>(m_curToken->text());
-            }
-        default:
-            assert(0);
+    f32_t v;
+    bool ok = false;
+    switch(eatToken(EF32Literal)) {
+    case ELitDecimalWithSuffix: ok = readDecimalFloat(m_curToken->text().rsubstr(1), v); break;
+    case ELitC99:               ok = readC99(m_curToken->text(), v); break;
+    case ELitHex:
+        {
+            IEEE754Traits<f32_t>::RawBitsType bits = 0;
+            ok = parseDigits(m_curToken->text(), 2, 16, bits);
+            v = f32_t::fromRawBits(bits);
         }
-    } catch (const istringstream::failure&) {
+        break;
+    default:
+        assert(0);
+    }
+    if (!ok) {
         syntaxError("invalid literal");
     }
-    return f32_t();
+    return v;
 }
 
 f64_t Scanner::readF64Literal()
 {
-    using namespace std;
-
-    try {
-        switch(eatToken(EF64Literal)) {
-        case ELitDecimal:
-            {
-                double v;
-                istringstreamalert(m_curToken->text()) >> v;
-                return f64_t(&v);
-            }
-        case ELitDecimalWithSuffix:
-            {
-                double v;
-                istringstreamalert(m_curToken->text().rsubstr(1)) >> v;
-                return f64_t(&v);
-            }
-        case ELitHex:
-            {
-                IEEE754Traits<f64_t>::RawBitsType v;
-                istringstreamalert(m_curToken->text().substr(2)) >> hex >> v;
-                return f64_t::fromRawBits(v);
-            }
-        case ELitC99:
-            {
-                return readC99<f64_t>(m_curToken->text());
-            }
-        default:
-            assert(0);
+    f64_t v;
+    bool ok = false;
+    switch(eatToken(EF64Literal)) {
+    case ELitDecimal:           ok = readDecimalFloat(m_curToken->text(), v); break;
+    case ELitDecimalWithSuffix: ok = readDecimalFloat(m_curToken->text().rsubstr(1), v); break;
+    case ELitC99:               ok = readC99(m_curToken->text(), v); break;
+    case ELitHex:
+        {
+            IEEE754Traits<f64_t>::RawBitsType bits = 0;
+            ok = parseDigits(m_curToken->text(), 2, 16, bits);
+            v = f64_t::fromRawBits(bits);
         }
-    } catch (const istringstream::failure&) {
+        break;
+    default:
+        assert(0);
+    }
+    if (!ok) {
         syntaxError("invalid literal");
     }
-    return f64_t();
+    return v;
 }
 
 
@@ -70,6 +70,7 @@ struct Guard {
 #include <memory>
 #include <vector>
 #include <string>
+#include <utility>
 #include <list>
 #include <iosfwd>
 #include <cassert>
@@ -81,6 +82,11 @@ struct SrcLoc
 };
 
 void printError(std::ostream& os, std::istream& is, const SrcLoc& errLoc, const char* message);
+void printError(std::ostream& os, const std::pair<std::string,unsigned>& context, const SrcLoc& errLoc, const char* message);
+/// print the position and message only, for errors whose line is not available.
+void printErrorPos(std::ostream& os, const SrcLoc& errLoc, const char* message);
+
+class StreamScannerBase;
 
 class SyntaxError
 {
@@ -109,6 +115,9 @@ public:
     void print(std::ostream& os, std::istream& is) const {
         printError(os,is,m_srcLoc,m_errorMessage.c_str());
     }
+    /// print using the text retained by the scanner, for streams
+    /// which cannot be read again.
+    void print(std::ostream& os, const StreamScannerBase& src) const;
 };
 
 class LexError : public SyntaxError
@@ -124,21 +133,71 @@ public:
     typedef std::vector<char>         BufferContainer;
 
 protected:
-    const char *m_end;
-
-    std::istream&   m_is;
-    BufferContainer m_buffer;
+    const char *m_begin;
+    const char *m_end;             // points to zero after the text
+
+    std::istream*   m_is;          // 0 for text in memory
+    BufferContainer m_buffer;      // text from m_bufferPos followed by zero,
+                                   // unless scanned in place
+    std::streamoff  m_bufferPos;   // stream offset of m_begin
+    int             m_bufferLine;  // line number of m_begin
+    // stream offsets of the lines from m_bufferLine up to the last one
+    // reached by the scanner, so that diagnostics need not count lines
+    std::vector<std::streamoff> m_lineStarts;
+    size_t          m_windowSize;  // 0 if all of the text is kept
+    bool            m_eof;
+    // earlier windows, still referenced by the statement being parsed
+    std::vector<BufferContainer> m_retired;
 
     void readChars(int n);
     void readBuffer();
+    size_t readChunk(size_t numBytes);
+    bool fillWindow(std::streamoff keepPos);
     std::streamoff  streamPosAt(const char *i) const;
+    const char*     ptrAt(std::streamoff pos) const;
+    void            addLineStart(int line, std::streamoff pos);
 
-public:
-    StreamScannerBase(std::istream& is);
+    // bulk scans used by the scanner rules, each returns the first position
+    // in [p,end) that stops it, or end; the SSE2/AVX2 versions are picked
+    // for the running CPU on first use, see selectScanImpl
+    static const char* skipBlanks(const char* p, const char* end);           // not ' ', '\t', '\n'
+    static const char* findLineEnd(const char* p, const char* end);          // '\r', '\n', '\0'
+    static const char* findCommentStop(const char* p, const char* end);      // '*', '\r', '\n', '\0'
+    static const char* findEmbeddedTextStop(const char* p, const char* end); // '#', '\r', '\n', '\0'
 
-    HSAIL_ASM::SRef getPlainText() const { return HSAIL_ASM::SRef(m_buffer); }
+public:
+    /// with non-zero windowSize only about windowSize bytes of the stream
+    /// are read ahead, and text before the position passed to fillWindow
+    /// is dropped. Otherwise the whole stream is read at once, or
+    /// incrementally if it cannot seek (pipes, stdin).
+    StreamScannerBase(std::istream& is, size_t windowSize = 0);
+    /// text is scanned in place, and must outlive the scanner, if its last
+    /// byte is zero (that is, length counts the terminator). Otherwise it
+    /// is copied.
+    StreamScannerBase(const char* text, size_t length);
+
+    /// whole text of the stream, or its part retained in the window.
+    HSAIL_ASM::SRef getPlainText() const { return HSAIL_ASM::SRef(m_begin, m_end + 1); }
+    bool isWindowed() const { return m_windowSize != 0; }
+
+    /// same as getContextString for the stream, but looks at the retained
+    /// text only; empty if the line of srcLoc has been dropped.
+    std::pair<std::string,unsigned> getContextString(const SrcLoc& srcLoc) const;
+
+    /// implementations of the bulk scans.
+    enum ScanImpl { SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2 };
+
+    /// make all scanners use impl for bulk scans from now on, e.g. to
+    /// compare implementations in tests. Not thread-safe.
+    /// @return false, keeping the current one, if impl is not supported
+    /// by the build or the running CPU.
+    static bool selectScanImpl(ScanImpl impl);
 };
 
+inline void SyntaxError::print(std::ostream& os, const StreamScannerBase& src) const {
+    printError(os,src.getContextString(m_srcLoc),m_srcLoc,m_errorMessage.c_str());
+}
+
 namespace HSAIL_ASM
 {
 
@@ -314,7 +373,9 @@ enum EScanContext {
 class Scanner : public StreamScannerBase
 {
 public:
-    explicit Scanner(std::istream& is, const ExtManager& extMgr = registeredExtensions(), bool disableComments = true);
+    explicit Scanner(std::istream& is, const ExtManager& extMgr = registeredExtensions(), bool disableComments = true, size_t windowSize = 0);
+    /// see StreamScannerBase(const char*, size_t).
+    Scanner(const char* text, size_t length, const ExtManager& extMgr = registeredExtensions(), bool disableComments = true);
 
     class Token {
         friend class Scanner;
@@ -348,6 +409,10 @@ public:
 
     void readSingleStringLiteral(std::string& outString);
 
+    /// text before the next token is no longer referenced by the parser
+    /// and may be dropped in window mode, see StreamScannerBase.
+    void releaseConsumed();
+
     void syntaxError(const std::string& message, const SrcLoc& srcLoc) const {
         throw SyntaxError(message, srcLoc);
     }
@@ -409,6 +474,9 @@ private:
 
     int                        m_lineNum;
     std::streamoff             m_lineStart;
+    int                        m_peekLineNum;   // m_lineNum before m_peekToken
+    std::streamoff             m_peekLineStart; // m_lineStart before m_peekToken
+    std::streamoff             m_releasedPos;
     bool                       m_disableComments;
 
     ExtManager m_extMgr;
@@ -416,8 +484,10 @@ private:
     class istringstreamalert;
     class Variant;
 
+    void         initTokens();
     Token&       newToken();
     Token&       scanNext(EScanContext ctx);
+    bool         refill();
 
     void         readSingleStringLiteral(Token &t, std::string& outString);
     ETokens      scanDefault(EScanContext ctx, Token &t);
@@ -425,8 +495,6 @@ private:
     Variant      readValueVariant();
     void         nextLine(const char *atPos);
     void         skipWhitespaces(Token& t);
-    const char*  skipOneLinearComment(const char* from, Token& t);
-    const char*  skipMultilineComment(const char* from, Token& t);
     void         scanEmbeddedText(Token &t);
 //    bool         continueMLComment(Token &t);
 
@@ -58,6 +58,14 @@
 #include "BrigDwarfGenerator.h"
 #endif
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
 
 #define BRIG_ASM_VERSION "3.0"
 
@@ -68,7 +76,8 @@ Tool::Tool(BrigContainer* c, const ExtManager& extMgr_)
   : m_container(c ? c : new BrigContainer()),
     owned(c == 0),
     extMgr(extMgr_),
-    vld(*m_container, extMgr)
+    vld(*m_container, extMgr),
+    m_operandBytesSaved(0)
 {
     initOptions();
 }
@@ -77,7 +86,8 @@ Tool::Tool(const ExtManager& extMgr_)
   : m_container(new BrigContainer()),
     owned(true),
     extMgr(extMgr_),
-    vld(*m_container, extMgr)
+    vld(*m_container, extMgr),
+    m_operandBytesSaved(0)
 {
 }
 
@@ -85,7 +95,8 @@ Tool::Tool(const void* brig_module, size_t size, bool copy, const ExtManager& ex
   : m_container(copy ? new BrigContainer() : new BrigContainer((BrigModule_t) brig_module)),
     owned(copy),
     extMgr(extMgr_),
-    vld(*m_container, extMgr)
+    vld(*m_container, extMgr),
+    m_operandBytesSaved(0)
 {
     initOptions();
     if (copy) {
@@ -124,6 +135,10 @@ const char *Tool::sectionBytesById(int section_id) const { return m_container->s
 
 size_t Tool::sectionSizeById(int section_id) const { return m_container->sectionById(section_id).size(); }
 
+uint64_t Tool::contentHash() const { return m_container->contentHash(); }
+
+bool Tool::verifyContentHash() { return m_container->verifyContentHash(out); }
+
 unsigned Tool::findCodeModuleSymbolOffset(const char *symbol_name) const
 {
     for (Code d = m_container->code().begin(), e = m_container->code().end(); d != e; ) {
@@ -143,21 +158,35 @@ unsigned Tool::findCodeModuleSymbolOffset(const char *symbol_name) const
 bool Tool::assembleFromStream(std::istream& is, const std::string& opts, const std::string& sourceDir, const std::string& sourceFileName)
 {
     if (!parseOptions(opts)) { return false; }
-    Scanner s(is, extMgr, true);
+    // debug info and the source section need all of the text
+    size_t const window = (IncludeSource || EnableDebugInfo) ? 0 : InputWindow;
+    Scanner s(is, extMgr, true, window);
+    return assemble(s, opts, sourceDir, sourceFileName);
+}
+
+bool Tool::assemble(Scanner& s, const std::string& opts, const std::string& sourceDir, const std::string& sourceFileName)
+{
+    m_container->reserveForSourceSize(s.getPlainText().length());
+    m_container->operands().setAnnotation(!DisableOperandSrcInfo);
     Parser p(s, *m_container);
+    // operands are merged after validation so that diagnostics refer to
+    // the source location of each operand occurrence
+    p.brigantine().setOperandOptimizer(false);
     try {
         p.parseSource();
     } catch (const SyntaxError& e) {
-        e.print(out, is);
+        e.print(out, s);
         out << std::endl;
         return false;
     }
     if (!DisableValidator) {
         if (!vld.validate(DumpFormatError)) {
-            out << vld.getErrorMsg(&is) << std::endl;
+            // in window mode only the position is known for lines already dropped
+            out << vld.getErrorMsg(s) << std::endl;
             return false;
         }
     }
+    m_operandBytesSaved = DisableOperandOptimizer ? 0 : m_container->optimizeOperands();
 #ifdef WITH_LIBBRIGDWARF
     if (EnableDebugInfo) {
         std::stringstream ssVersion;
@@ -183,23 +212,40 @@ bool Tool::assembleFromStream(std::istream& is, const std::string& opts, const s
     if (IncludeSource) {
       p.saveSourceToContainer();
     }
+    if (MemoryStats) {
+        BrigMemoryStats stats;
+        m_container->getMemoryStats(stats);
+        out << stats;
+        out << "operand optimizer: " << m_operandBytesSaved << " bytes saved" << std::endl;
+    }
     return true;
 }
 
 bool Tool::assembleFromMemory(const char *text, size_t text_length, const std::string& opts, const std::string& sourceDir, const std::string& sourceFileName)
 {
-    std::istringstream is(std::string(text, text_length));
-    return assembleFromStream(is, opts, sourceDir, sourceFileName);
+    if (!parseOptions(opts)) { return false; }
+    Scanner s(text, text_length, extMgr, true);
+    return assemble(s, opts, sourceDir, sourceFileName);
+}
+
+bool Tool::assembleFromText(const char *text, const std::string& opts, const std::string& sourceDir, const std::string& sourceFileName)
+{
+    return assembleFromMemory(text, strlen(text) + 1, opts, sourceDir, sourceFileName);
 }
 
 bool Tool::assembleFromString(const std::string& text, const std::string& opts, const std::string& sourceDir, const std::string& sourceFileName)
 {
-    std::istringstream is(text);
-    return assembleFromStream(is, opts, sourceDir, sourceFileName);
+    return assembleFromMemory(text.c_str(), text.size() + 1, opts, sourceDir, sourceFileName);
 }
 
 bool Tool::assembleFromFile(const std::string& filename, const std::string& opts)
 {
+    if (filename == "-") {
+        char *cwd = getcwd(0, 0);
+        bool result = assembleFromStream(std::cin, opts, cwd, "<stdin>");
+        free(cwd);
+        return result;
+    }
     std::ifstream ifs(filename, std::ifstream::in | std::ifstream::binary);
     if ((!ifs.is_open()) || ifs.bad()) {
         out << "Error: Failed to open "<< filename << std::endl;
@@ -246,12 +292,29 @@ bool Tool::loadFromMem(const char* buf, size_t size, bool writable)
     if (0 != BrigIO::load(*m_container, FileFormat, BrigIO::memoryReadingAdapter(buf, size, out), writable)) {
         return false;
     }
-    return true;
+    return !VerifyHash || verifyContentHash();
 }
 
 bool Tool::loadFromFile(const std::string& filename, bool writable)
 {
-    if (0 != BrigIO::load(*m_container, FileFormat, BrigIO::fileReadingAdapter(filename.c_str(), out), writable)) {
+    if (LazyLoad) {
+        // sections of a mapped file are used in place, so it is read instead
+        std::shared_ptr<ReadAdapter> const r(BrigIO::fileReadingAdapter(filename.c_str(), out).release());
+        if (!r || 0 != BrigIO::loadLazily(*m_container, FileFormat, r)) {
+            return false;
+        }
+        return !VerifyHash || verifyContentHash();
+    }
+    if (0 != BrigIO::load(*m_container, FileFormat, BrigIO::mappedFileReadingAdapter(filename.c_str(), out), writable)) {
+        return false;
+    }
+    return !VerifyHash || verifyContentHash();
+}
+
+bool Tool::sectionsLoaded()
+{
+    if (m_container->lazyLoadFailed()) {
+        out << "Error: Failed to load BRIG sections of " << InputFilename << std::endl;
         return false;
     }
     return true;
@@ -260,7 +323,8 @@ bool Tool::loadFromFile(const std::string& filename, bool writable)
 bool Tool::saveToFile(const std::string& filename)
 {
     if (FileFormat == FILE_FORMAT_AUTO) { FileFormat = FILE_FORMAT_BRIG; }
-    if (0 != BrigIO::save(*m_container, FileFormat, BrigIO::fileWritingAdapter(filename.c_str(), out))) {
+    int const fmt = FileFormat | (Compress ? FILE_FORMAT_COMPRESSED : 0);
+    if (0 != BrigIO::save(*m_container, fmt, BrigIO::fileWritingAdapter(filename.c_str(), out))) {
         return false;
     }
 #ifdef WITH_LIBBRIGDWARF
@@ -269,6 +333,103 @@ bool Tool::saveToFile(const std::string& filename)
     return true;
 }
 
+/// module name for file name: the file name without directory and extension.
+static std::string moduleNameFor(const std::string& filename)
+{
+    std::string::size_type const slash = filename.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? filename : filename.substr(slash + 1);
+    std::string::size_type const dot = name.find_last_of('.');
+    if (dot != std::string::npos && dot > 0) { name.erase(dot); }
+    return name;
+}
+
+bool Tool::packToFile(const std::vector<std::string>& inputs, const std::string& filename)
+{
+    std::vector<std::unique_ptr<BrigContainer> > modules;
+    std::vector<BrigContainer*> ptrs;
+    std::vector<std::string> names;
+    for (std::vector<std::string>::const_iterator i = inputs.begin(); i != inputs.end(); ++i) {
+        modules.push_back(std::unique_ptr<BrigContainer>(new BrigContainer()));
+        BrigContainer& c = *modules.back();
+        // read modules into memory rather than map them, archives may
+        // collect more modules than there may be mappings
+        if (0 != BrigIO::load(c, FileFormat, BrigIO::fileReadingAdapter(i->c_str(), out))) {
+            return false;
+        }
+        if (VerifyHash && !c.verifyContentHash(out)) { return false; }
+        ptrs.push_back(&c);
+        names.push_back(moduleNameFor(*i));
+    }
+    std::unique_ptr<WriteAdapter> const w = BrigIO::fileWritingAdapter(filename.c_str(), out);
+    return w && 0 == BrigIO::saveArchive(ptrs, names, *w);
+}
+
+bool Tool::listArchive(const std::string& filename)
+{
+    std::unique_ptr<ReadAdapter> const r = BrigIO::mappedFileReadingAdapter(filename.c_str(), out);
+    std::vector<BrigArchiveEntry> entries;
+    if (!r || 0 != BrigIO::listArchive(*r, entries)) { return false; }
+    for (std::vector<BrigArchiveEntry>::const_iterator i = entries.begin(); i != entries.end(); ++i) {
+        char hash[17];
+        snprintf(hash, sizeof hash, "%016llx", (unsigned long long)i->hash);
+        out << hash << " " << i->byteCount << " " << i->name << std::endl;
+    }
+    return true;
+}
+
+bool Tool::loadFromArchive(const std::string& filename, const std::string& moduleName, bool writable)
+{
+    std::unique_ptr<ReadAdapter> const r = BrigIO::mappedFileReadingAdapter(filename.c_str(), out);
+    if (!r || 0 != BrigIO::loadFromArchive(*m_container, *r, moduleName.c_str(), writable)) {
+        return false;
+    }
+    return !VerifyHash || verifyContentHash();
+}
+
+bool Tool::extractFromArchive(const std::string& filename, const std::vector<std::string>& moduleNames)
+{
+    std::unique_ptr<ReadAdapter> const r = BrigIO::mappedFileReadingAdapter(filename.c_str(), out);
+    if (!r) { return false; }
+    std::vector<std::string> names(moduleNames);
+    if (names.empty()) {
+        std::vector<BrigArchiveEntry> entries;
+        if (0 != BrigIO::listArchive(*r, entries)) { return false; }
+        for (std::vector<BrigArchiveEntry>::const_iterator i = entries.begin(); i != entries.end(); ++i) {
+            names.push_back(i->name);
+        }
+    }
+    if (FileFormat == FILE_FORMAT_AUTO) { FileFormat = FILE_FORMAT_BRIG; }
+    for (std::vector<std::string>::const_iterator i = names.begin(); i != names.end(); ++i) {
+        BrigContainer c;
+        // output files are named after the module as recorded in the
+        // archive, whose names are checked not to leave the directory
+        std::string moduleName = *i;
+        if (ByHash && !moduleNames.empty()) {
+            if (i->empty() || i->size() > 16 ||
+                i->find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+                out << "Error: Invalid module content hash: " << *i << std::endl;
+                return false;
+            }
+            uint64_t const hash = strtoull(i->c_str(), NULL, 16);
+            BrigArchiveEntry entry;
+            int const rc = BrigIO::findInArchive(*r, hash, entry);
+            if (rc < 0) { out << "Module with hash " << *i << " not found in Brig archive" << std::endl; }
+            if (rc != 0 || 0 != BrigIO::loadFromArchive(c, *r, hash)) { return false; }
+            moduleName = entry.name;
+        } else {
+            if (0 != BrigIO::loadFromArchive(c, *r, i->c_str())) { return false; }
+        }
+        if (VerifyHash && !c.verifyContentHash(out)) { return false; }
+        std::string const outName = (names.size() == 1 && !OutputFilename.empty()) ?
+            OutputFilename : moduleName + outputExt();
+        int const fmt = FileFormat | (Compress ? FILE_FORMAT_COMPRESSED : 0);
+        if (0 != BrigIO::save(c, fmt, BrigIO::fileWritingAdapter(outName.c_str(), out))) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool Tool::validate()
 {
     if (!vld.validate(true)) {
@@ -310,27 +471,41 @@ bool Tool::printToolHelp()
   out <<
     "HSAIL Assembler and Disassembler." << std::endl <<
     std::endl <<
-    "Usage: HSAILAsm [-assemble|-disassemble|-decode|-version|-help] [options] [input file]" << std::endl <<
+    "Usage: HSAILAsm [-assemble|-disassemble|-decode|-version|-help] [options] [input files]" << std::endl <<
+    "       HSAILAsm -pack [options] [input files]" << std::endl <<
+    "       HSAILAsm -list|-extract [options] [archive file] [module names]" << std::endl <<
     std::endl <<
     "Action to perform:" << std::endl <<
-    "  -assemble          - Assemble a .hsail file (default)" << std::endl <<
+    "  -assemble          - Assemble a .hsail file, - for standard input (default)" << std::endl <<
     "  -disassemble       - Disassemble an .brig file" << std::endl <<
     "  -version           - Display version information" << std::endl <<
     "  -decode            - Decode contents of .brig file in YAML format" << std::endl <<
+    "  -pack              - Pack .brig files into a BRIG archive" << std::endl <<
+    "  -list              - List modules of a BRIG archive" << std::endl <<
+    "  -extract           - Extract modules (all if none is named) from a BRIG archive" << std::endl <<
     "  -help              - Display this help" << std::endl <<
     std::endl <<
     "Options:" << std::endl <<
     "  -bif32             - Use BIF in ELF32 container format" << std::endl <<
     "  -bif64             - Use BIF in ELF64 container format" << std::endl <<
     "  -brig              - Use BRIG format" << std::endl <<
+    "  -compress          - Compress BRIG output" << std::endl <<
+    "  -lazy              - Read sections of BRIG input on first use instead of mapping the file" << std::endl <<
+    "  -verify-hash       - Check content hash of BRIG modules on load" << std::endl <<
+    "  -by-hash           - Name modules to extract by content hash as printed by -list" << std::endl <<
     "  -enable-comments   - Enable Comments in BRIG" << std::endl <<
+    "  -disable-operand-optimizer - Do not merge identical operands on assemble" << std::endl <<
+    "  -disable-operand-srcinfo - Do not record source locations of operands on assemble" << std::endl <<
+    "  -memory-stats      - Print memory used by BRIG container after assemble" << std::endl <<
+    "  -input-window <n>  - Keep about n bytes of HSAIL text in memory on assemble (validator errors may lack the source line)" << std::endl <<
     "  -g                 - Enable debug info generation for assemble" << std::endl <<
     "  -include-source    - Include HSAIL text in debug information" << std::endl <<
     "  -o <filename>      - Set output filename (if not specified, input file name with appropriate extension is used)" << std::endl <<
+    "  -jobs <n>          - Process up to n input files at once (default: one per core)" << std::endl <<
     "  -odebug <filename> - Set debug information dump filename and enable dump" << std::endl <<
     "  -floatraw          - Set float disassembly mode to 0[DFH]rawbits" << std::endl <<
     "  -floatc99          - Set float disassembly mode to +-0xX.XXXp+-DD C99 format" << std::endl <<
-    "  -floatdec          - Set float disassembly mode to decimal form" << std::endl;
+    "  -floatdec          - Set float disassembly mode to the shortest decimal form that reads back exactly" << std::endl;
     return true;
 }
 
@@ -372,15 +547,24 @@ void Tool::initOptions()
 {
     action = NOACTION;
     InputFilename.clear();
+    MoreInputFilenames.clear();
     OutputFilename.clear();
     FileFormat = FILE_FORMAT_AUTO;
     IncludeSource = false;
     DisableValidator = false;
     DisableOperandOptimizer = false;
+    DisableOperandSrcInfo = false;
+    MemoryStats = false;
+    VerifyHash = false;
+    Compress = false;
+    ByHash = false;
+    LazyLoad = false;
     EnableComments = false;
     DisasmInstOffset = false;
     DumpFormatError = false;
     FloatDisassemblyMode = FloatDisassemblyModeRawBits;
+    NumJobs = 0;
+    InputWindow = 0;
     RepeatForever = false;
     EnableDebugInfo = false;
     DebugInfoFilename.clear();
@@ -426,18 +610,30 @@ bool Tool::parseOptions(const std::string& opts, bool execute)
         else if (execute && opt == "-disassemble") { action = DISASSEMBLE; }
         else if (execute && opt == "-validate") { action = VALIDATE; }
         else if (execute && opt == "-decode") { action = DECODE; }
+        else if (execute && opt == "-pack") { action = PACK; }
+        else if (execute && opt == "-list") { action = LIST; }
+        else if (execute && opt == "-extract") { action = EXTRACT; }
         else if (execute && opt == "-o") { if (!(iss >> OutputFilename)) { out << "Error: Expected output file name after -o" << std::endl; return false; } }
+        else if (execute && opt == "-jobs") { if (!(iss >> NumJobs) || NumJobs == 0) { out << "Error: Expected positive number of jobs after -jobs" << std::endl; return false; } }
         else if (opt == "-bif32") { FileFormat = FILE_FORMAT_BIF | FILE_FORMAT_ELF32; }
         else if (opt == "-bif64") { FileFormat = FILE_FORMAT_BIF | FILE_FORMAT_ELF64; }
         else if (opt == "-brig") { FileFormat = FILE_FORMAT_BRIG; }
+        else if (opt == "-compress") { Compress = true; }
+        else if (execute && opt == "-by-hash") { ByHash = true; }
+        else if (execute && opt == "-lazy") { LazyLoad = true; }
         else if (opt == "-disable-operand-optimizer") { DisableOperandOptimizer = true; }
+        else if (opt == "-disable-operand-srcinfo") { DisableOperandSrcInfo = true; }
         else if (opt == "-enable-comments") { EnableComments = true; }
+        else if (opt == "-memory-stats") { MemoryStats = true; }
+        else if (opt == "-input-window") { if (!(iss >> InputWindow) || InputWindow == 0) { out << "Error: Expected positive number of bytes after -input-window" << std::endl; return false; } }
+        else if (opt == "-verify-hash") { VerifyHash = true; }
         else if (opt == "-floatraw") { FloatDisassemblyMode = FloatDisassemblyModeRawBits; }
         else if (opt == "-floatc99") { FloatDisassemblyMode = FloatDisassemblyModeC99; }
         else if (opt == "-floatdec") { FloatDisassemblyMode = FloatDisassemblyModeDecimal; }
         else if (opt == "-disasm-inst-offset") { DisasmInstOffset = true; }
         else if (opt == "-dump-format-error") { DumpFormatError = true; }
         else if (execute && InputFilename.empty()) { InputFilename = opt; }
+        else if (execute && action != LIST && action != VERSION && action != HELP) { MoreInputFilenames.push_back(opt); }
         else {
           out << "Error: Invalid libHSAIL option: " + opt << std::endl;
           return false;
@@ -460,6 +656,13 @@ const char *Tool::outputExt() const
       return ".hsail";
     case DECODE:
       return ".yaml";
+    case PACK:
+      return ".brar";
+    case EXTRACT:
+      switch (FileFormat & FILE_FORMAT_MASK) {
+      case FILE_FORMAT_BIF: return ".bif";
+      default: return ".brig";
+      }
     default:
       assert(false);
       return "<invalidext>";
@@ -495,6 +698,134 @@ void Tool::SetBrig()
     FileFormat = FILE_FORMAT_BRIG;
 }
 
+bool Tool::executeAction(const std::string& opts)
+{
+    bool result = false;
+    if (action == NOACTION && !InputFilename.empty()) { action = ASSEMBLE; }
+    switch (action) {
+    case VERSION:
+      result = printToolVersion();
+      break;
+    case HELP:
+      result = printToolHelp();
+      break;
+    case ASSEMBLE:
+      if (InputFilename.empty()) { out << "Error: No input file specified." << std::endl; result = false; break; }
+      if (InputFilename == "-" && OutputFilename.empty()) { out << "Error: Output file name is required for standard input." << std::endl; result = false; break; }
+      if (FileFormat == FILE_FORMAT_AUTO) { FileFormat = FILE_FORMAT_BRIG; }
+      result = assembleFromFile(InputFilename, opts) && saveToFile(outputFilename());
+      break;
+    case DISASSEMBLE:
+      if (InputFilename.empty()) { out << "Error: No input file specified." << std::endl; result = false; break; }
+      result = loadFromFile(InputFilename) && disassembleToFile(outputFilename(), opts) && sectionsLoaded();
+      break;
+    case VALIDATE:
+      result = loadFromFile(InputFilename) && validate() && sectionsLoaded();
+      break;
+    case DECODE:
+      if (InputFilename.empty()) { out << "Error: No input file specified." << std::endl; result = false; break; }
+      result = loadFromFile(InputFilename) && decodeToFile(outputFilename()) && sectionsLoaded();
+      break;
+    case PACK: {
+      if (InputFilename.empty()) { out << "Error: No input file specified." << std::endl; result = false; break; }
+      std::vector<std::string> inputs(1, InputFilename);
+      inputs.insert(inputs.end(), MoreInputFilenames.begin(), MoreInputFilenames.end());
+      result = packToFile(inputs, outputFilename());
+      break;
+      }
+    case LIST:
+      if (InputFilename.empty()) { out << "Error: No input file specified." << std::endl; result = false; break; }
+      result = listArchive(InputFilename);
+      break;
+    case EXTRACT:
+      if (InputFilename.empty()) { out << "Error: No input file specified." << std::endl; result = false; break; }
+      result = extractFromArchive(InputFilename, MoreInputFilenames);
+      break;
+    case NOACTION:
+      out << "Error: No action specified (-help for help)." << std::endl;
+      result = false;
+      break;
+    default:
+      out << "Error: Invalid action specified: " << action << std::endl;
+      assert(false);
+      result = false;
+      break;
+    }
+    return result;
+}
+
+/// run the action on each of inputs as if it were the only input. Up to
+/// NumJobs inputs are in flight at once, so that reading one input
+/// overlaps with parsing, validating and writing others. Each input is
+/// handled by a Tool of its own; their messages are collected in input
+/// order under the input name, so the output does not depend on scheduling.
+bool Tool::executeMany(const std::string& opts, const std::vector<std::string>& inputs)
+{
+    if (!OutputFilename.empty()) {
+        out << "Error: -o cannot be used with several input files." << std::endl;
+        return false;
+    }
+    // jobs for the same input would write the same output file at once
+    std::set<std::string> seen;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (!seen.insert(inputs[i]).second) {
+            out << "Error: Input file " << inputs[i] << " is given more than once." << std::endl;
+            return false;
+        }
+    }
+    struct Job {
+        std::string output;
+        bool        done;
+        bool        result;
+        Job() : done(false), result(false) {}
+    };
+    std::vector<Job> jobs(inputs.size());
+    std::mutex m;
+    std::condition_variable jobDone;
+    std::atomic<size_t> next(0);
+
+    auto const work = [&]() {
+        for (size_t i; (i = next++) < inputs.size(); ) {
+            Tool t(0, extMgr);
+            bool r = t.parseOptions(opts, true);
+            if (r) {
+                t.InputFilename = inputs[i];
+                t.MoreInputFilenames.clear();
+                r = t.executeAction(opts);
+            }
+            std::lock_guard<std::mutex> lock(m);
+            jobs[i].output = t.output();
+            jobs[i].result = r;
+            jobs[i].done = true;
+            jobDone.notify_all();
+        }
+    };
+    size_t numThreads = NumJobs != 0 ? NumJobs : std::thread::hardware_concurrency();
+    numThreads = (std::max)((size_t)1, (std::min)(numThreads, inputs.size()));
+    std::vector<std::thread> workers;
+    for (size_t k = 0; k < numThreads; ++k) {
+        workers.push_back(std::thread(work));
+    }
+
+    bool result = true;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        std::string output;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            jobDone.wait(lock, [&]() { return jobs[i].done; });
+            output.swap(jobs[i].output);
+            result = jobs[i].result && result;
+        }
+        if (!output.empty()) {
+            out << inputs[i] << ":" << std::endl << output;
+        }
+    }
+    for (std::vector<std::thread>::iterator i = workers.begin(); i != workers.end(); ++i) {
+        i->join();
+    }
+    return result;
+}
+
 bool Tool::execute(const std::string& opts)
 {
     int pass = 0;
@@ -502,38 +833,12 @@ bool Tool::execute(const std::string& opts)
     do {
         if (parseOptions(opts, true)) {
             if (action == NOACTION && !InputFilename.empty()) { action = ASSEMBLE; }
-            switch (action) {
-            case VERSION:
-              result = printToolVersion();
-              break;
-            case HELP:
-              result = printToolHelp();
-              break;
-            case ASSEMBLE:
-              if (InputFilename.empty()) { out << "Error: No input file specified." << std::endl; result = false; break; }
-              if (FileFormat == FILE_FORMAT_AUTO) { FileFormat = FILE_FORMAT_BRIG; }
-              result = assembleFromFile(InputFilename, opts) && saveToFile(outputFilename());
-              break;
-            case DISASSEMBLE:
-              if (InputFilename.empty()) { out << "Error: No input file specified." << std::endl; result = false; break; }
-              result = loadFromFile(InputFilename) && disassembleToFile(outputFilename(), opts);
-              break;
-            case VALIDATE:
-              result = loadFromFile(InputFilename) && validate();
-              break;
-            case DECODE:
-              if (InputFilename.empty()) { out << "Error: No input file specified." << std::endl; result = false; break; }
-              result = loadFromFile(InputFilename) && decodeToFile(outputFilename());
-              break;
-            case NOACTION:
-              out << "Error: No action specified (-help for help)." << std::endl;
-              result = false;
-              break;
-            default:
-              out << "Error: Invalid action specified: " << action << std::endl;
-              assert(false);
-              result = false;
-              break;
+            if (!MoreInputFilenames.empty() && action != PACK && action != EXTRACT) {
+                std::vector<std::string> inputs(1, InputFilename);
+                inputs.insert(inputs.end(), MoreInputFilenames.begin(), MoreInputFilenames.end());
+                result = executeMany(opts, inputs);
+            } else {
+                result = executeAction(opts);
             }
             if (RepeatForever) {
                 out << "Pass " << pass++ << ", result " << result << std::endl;
@@ -43,6 +43,7 @@
 #define INCLUDED_HSAIL_TOOL_H
 
 #include <string>
+#include <vector>
 #include <istream>
 #include <ostream>
 #include <sstream>
@@ -58,6 +59,7 @@ namespace HSAIL_ASM
 {
 
 class BrigContainer;
+class Scanner;
 
 enum Action {
     NOACTION,
@@ -67,6 +69,9 @@ enum Action {
     DISASSEMBLE,
     VALIDATE,
     DECODE,
+    PACK,
+    LIST,
+    EXTRACT,
 };
 
 /*
@@ -111,9 +116,18 @@ public:
     const char *sectionBytesById(int section_id) const;
     size_t sectionSizeById(int section_id) const;
     unsigned findCodeModuleSymbolOffset(const char *symbol_name) const;
+    /// hash of the module contents, see BrigContainer::contentHash.
+    uint64_t contentHash() const;
+    bool verifyContentHash();
+    /// number of operand section bytes saved by operand optimizer on last assemble.
+    size_t operandBytesSaved() const { return m_operandBytesSaved; }
 
     bool assembleFromStream(std::istream& is, const std::string& opts = "", const std::string& sourceDir = "", const std::string& sourceFileName = "");
+    /// text is scanned in place when text_length counts a terminating
+    /// zero, otherwise it is copied once.
     bool assembleFromMemory(const char *text, size_t text_length, const std::string& opts = "", const std::string& sourceDir = "", const std::string& sourceFileName = "");
+    /// zero terminated text, scanned in place.
+    bool assembleFromText(const char *text, const std::string& opts = "", const std::string& sourceDir = "", const std::string& sourceFileName = "");
     bool assembleFromString(const std::string& text, const std::string& opts = "", const std::string& sourceDir = "", const std::string& sourceFileName = "");
     bool assembleFromFile(const std::string& filename, const std::string& opts = "");
 
@@ -125,6 +139,17 @@ public:
 
     bool saveToFile(const std::string& filename);
 
+    /// @name BRIG archives, see BrigIO::saveArchive.
+    /// @{
+    bool packToFile(const std::vector<std::string>& inputs, const std::string& filename);
+    bool listArchive(const std::string& filename);
+    bool loadFromArchive(const std::string& filename, const std::string& moduleName, bool writable = false);
+    /// save modules of the archive (all if moduleNames is empty) each to
+    /// its own file named after the module. With -by-hash, modules are
+    /// named by content hashes as printed by listArchive.
+    bool extractFromArchive(const std::string& filename, const std::vector<std::string>& moduleNames);
+    /// @}
+
     bool validate();
     void dumpValidatorError(std::ostream& out);
 
@@ -153,18 +178,27 @@ private:
     Action action;
     std::string options;
     std::string InputFilename, OutputFilename;
+    std::vector<std::string> MoreInputFilenames; // for actions taking several inputs
     int FileFormat, FloatDisassemblyMode;
-    bool IncludeSource, DisableValidator, DisableOperandOptimizer,
+    unsigned NumJobs; // threads for several inputs, 0 for one per core
+    size_t InputWindow; // bytes of text read ahead on assemble, 0 for all
+    bool IncludeSource, DisableValidator, DisableOperandOptimizer, DisableOperandSrcInfo,
          EnableComments, DisasmInstOffset, DumpFormatError,
-         RepeatForever;
+         RepeatForever, MemoryStats, VerifyHash, Compress, ByHash, LazyLoad;
 
     const ExtManager& extMgr;
     Validator vld;
+    size_t m_operandBytesSaved;
 
     bool EnableDebugInfo;
     std::string DebugInfoFilename;
 
     void initOptions();
+    bool assemble(Scanner& s, const std::string& opts, const std::string& sourceDir, const std::string& sourceFileName);
+    bool executeAction(const std::string& opts);
+    /// false if a section of a lazily loaded input failed to load (-lazy).
+    bool sectionsLoaded();
+    bool executeMany(const std::string& opts, const std::vector<std::string>& inputs);
     std::string outputFilename(const char *ext = 0) const;
     const char *outputExt() const;
 };
@@ -46,6 +46,8 @@
 #include <cassert>
 #include <sstream>
 #include <algorithm>
+#include <cstring>
+#include <vector>
 
 using std::ostringstream;
 
@@ -1210,6 +1212,301 @@ size_t zeroPaddedCopy(void *dst, const void* src, size_t len, size_t room)
     return toCopy;
 }
 
+/// FNV-1a hash of len bytes starting at data.
+size_t hashBytes(const void* data, size_t len)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return static_cast<size_t>(h);
+}
+
+static const uint64_t XXH_PRIME1 = 11400714785074694791ULL;
+static const uint64_t XXH_PRIME2 = 14029467366897019727ULL;
+static const uint64_t XXH_PRIME3 =  1609587929392839161ULL;
+static const uint64_t XXH_PRIME4 =  9650029242287828579ULL;
+static const uint64_t XXH_PRIME5 =  2870177450012600261ULL;
+
+static inline uint64_t rotl64(uint64_t x, unsigned r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t readLE64(const unsigned char* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+static inline uint32_t readLE32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t xxhRound(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME2;
+    acc = rotl64(acc, 31);
+    return acc * XXH_PRIME1;
+}
+
+static inline uint64_t xxhMergeRound(uint64_t acc, uint64_t val) {
+    acc ^= xxhRound(0, val);
+    return acc * XXH_PRIME1 + XXH_PRIME4;
+}
+
+static inline void xxhStripe(uint64_t (&acc)[4], const unsigned char* p) {
+    acc[0] = xxhRound(acc[0], readLE64(p));
+    acc[1] = xxhRound(acc[1], readLE64(p + 8));
+    acc[2] = xxhRound(acc[2], readLE64(p + 16));
+    acc[3] = xxhRound(acc[3], readLE64(p + 24));
+}
+
+ContentHasher::ContentHasher(uint64_t seed)
+    : m_seed(seed)
+    , m_total(0)
+    , m_tailSize(0)
+{
+    m_acc[0] = seed + XXH_PRIME1 + XXH_PRIME2;
+    m_acc[1] = seed + XXH_PRIME2;
+    m_acc[2] = seed;
+    m_acc[3] = seed - XXH_PRIME1;
+}
+
+void ContentHasher::update(const void* data, size_t len)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* const end = p + len;
+    m_total += len;
+
+    if (m_tailSize + len < STRIPE) {
+        if (len > 0) memcpy(m_tail + m_tailSize, p, len);
+        m_tailSize += (unsigned)len;
+        return;
+    }
+    if (m_tailSize > 0) {
+        size_t const fill = STRIPE - m_tailSize;
+        memcpy(m_tail + m_tailSize, p, fill);
+        xxhStripe(m_acc, m_tail);
+        p += fill;
+        m_tailSize = 0;
+    }
+    for (; end - p >= STRIPE; p += STRIPE) {
+        xxhStripe(m_acc, p);
+    }
+    m_tailSize = (unsigned)(end - p);
+    if (m_tailSize > 0) memcpy(m_tail, p, m_tailSize);
+}
+
+uint64_t ContentHasher::digest() const
+{
+    uint64_t h;
+    if (m_total >= STRIPE) {
+        h = rotl64(m_acc[0], 1) + rotl64(m_acc[1], 7) +
+            rotl64(m_acc[2], 12) + rotl64(m_acc[3], 18);
+        for (int i = 0; i < 4; ++i) h = xxhMergeRound(h, m_acc[i]);
+    } else {
+        h = m_seed + XXH_PRIME5;
+    }
+    h += m_total;
+
+    const unsigned char* p = m_tail;
+    const unsigned char* const end = m_tail + m_tailSize;
+    for (; end - p >= 8; p += 8) {
+        h ^= xxhRound(0, readLE64(p));
+        h = rotl64(h, 27) * XXH_PRIME1 + XXH_PRIME4;
+    }
+    if (end - p >= 4) {
+        h ^= (uint64_t)readLE32(p) * XXH_PRIME1;
+        h = rotl64(h, 23) * XXH_PRIME2 + XXH_PRIME3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= (*p) * XXH_PRIME5;
+        h = rotl64(h, 11) * XXH_PRIME1;
+    }
+    h ^= h >> 33;
+    h *= XXH_PRIME2;
+    h ^= h >> 29;
+    h *= XXH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+// LZ block format: sequences of a token byte, literal length extension,
+// literals, 2-byte little-endian match offset and match length extension.
+// The token holds the literal length in the high and the match length
+// minus LZ_MIN_MATCH in the low nibble; a nibble of 15 is continued by
+// bytes added to it up to the first byte other than 255. The last
+// sequence has literals only.
+
+static const unsigned LZ_MIN_MATCH = 4;
+static const unsigned LZ_HASH_LOG = 14;
+static const size_t   LZ_MAX_OFFSET = 65535;
+static const size_t   LZ_LAST_LITERALS = 8; // matches are not looked for near the end
+
+static inline uint32_t lzRead32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+static inline unsigned lzHash(uint32_t seq) {
+    return (seq * 2654435761U) >> (32 - LZ_HASH_LOG);
+}
+
+static inline unsigned char* lzPutLength(unsigned char* op, size_t len) {
+    for (; len >= 255; len -= 255) *op++ = 255;
+    *op++ = (unsigned char)len;
+    return op;
+}
+
+static unsigned char* lzPutSequence(unsigned char* op,
+                                    const unsigned char* literals, size_t numLiterals,
+                                    size_t offset, size_t matchLength) {
+    unsigned char* const token = op++;
+    *token = (unsigned char)((numLiterals < 15 ? numLiterals : 15) << 4);
+    if (numLiterals >= 15) op = lzPutLength(op, numLiterals - 15);
+    memcpy(op, literals, numLiterals);
+    op += numLiterals;
+    if (matchLength == 0) return op; // the last sequence
+    *op++ = (unsigned char)offset;
+    *op++ = (unsigned char)(offset >> 8);
+    size_t const ml = matchLength - LZ_MIN_MATCH;
+    *token |= (unsigned char)(ml < 15 ? ml : 15);
+    if (ml >= 15) op = lzPutLength(op, ml - 15);
+    return op;
+}
+
+size_t lzCompressBound(size_t len)
+{
+    return len + len / 255 + 16;
+}
+
+uint64_t lzDecompressBound(uint64_t len)
+{
+    // each extra length byte adds at most 255 bytes of output
+    return len * 255;
+}
+
+size_t lzCompress(const char* src, size_t len, char* dst)
+{
+    const unsigned char* const start = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char* const end = start + len;
+    unsigned char* op = reinterpret_cast<unsigned char*>(dst);
+
+    const unsigned char* ip = start;
+    const unsigned char* anchor = start;
+    if (len > LZ_LAST_LITERALS + LZ_MIN_MATCH) {
+        const unsigned char* const limit = end - LZ_LAST_LITERALS;
+        std::vector<uint32_t> table(size_t(1) << LZ_HASH_LOG, 0);
+        unsigned misses = 0;
+        while (ip < limit) {
+            uint32_t const seq = lzRead32(ip);
+            uint32_t& slot = table[lzHash(seq)];
+            const unsigned char* const ref = start + slot;
+            slot = (uint32_t)(ip - start);
+            if (ref >= ip || (size_t)(ip - ref) > LZ_MAX_OFFSET || lzRead32(ref) != seq) {
+                // skip faster through data which does not compress
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+            const unsigned char* p = ip + LZ_MIN_MATCH;
+            const unsigned char* q = ref + LZ_MIN_MATCH;
+            while (p < end && *p == *q) { ++p; ++q; }
+            op = lzPutSequence(op, anchor, ip - anchor, ip - ref, p - ip);
+            ip = anchor = p;
+            if (ip - 2 >= start && ip < limit) {
+                table[lzHash(lzRead32(ip - 2))] = (uint32_t)(ip - 2 - start);
+            }
+        }
+    }
+    op = lzPutSequence(op, anchor, end - anchor, 0, 0);
+    return (size_t)(op - reinterpret_cast<unsigned char*>(dst));
+}
+
+static inline bool lzGetLength(const unsigned char*& ip, const unsigned char* end, size_t& len) {
+    unsigned char b;
+    do {
+        if (ip >= end) return false;
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+/// copy match of matchLength bytes at offset back from op, which must fit
+/// before oend. Copies in chunks where they cannot overlap or overrun oend.
+static inline void lzCopyMatch(unsigned char* op, size_t offset, size_t matchLength,
+                               const unsigned char* oend) {
+    const unsigned char* m = op - offset;
+    unsigned char* const mend = op + matchLength;
+    if (offset >= 16 && (size_t)(oend - op) >= matchLength + 16) {
+        for (; op < mend; op += 16, m += 16) memcpy(op, m, 16);
+    } else if (offset >= 8 && (size_t)(oend - op) >= matchLength + 8) {
+        for (; op < mend; op += 8, m += 8) memcpy(op, m, 8);
+    } else {
+        for (; op < mend; ++op, ++m) *op = *m;
+    }
+}
+
+bool lzDecompress(const char* src, size_t len, char* dst, size_t dstLen)
+{
+    const unsigned char* ip = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char* const iend = ip + len;
+    unsigned char* op = reinterpret_cast<unsigned char*>(dst);
+    unsigned char* const ostart = op;
+    unsigned char* const oend = op + dstLen;
+
+    for (;;) {
+        if (ip >= iend) return false;
+        unsigned const token = *ip++;
+        size_t numLiterals = token >> 4;
+        size_t matchLength = token & 15;
+
+        // most sequences are short; away from the ends of the buffers
+        // they are copied in fixed-size chunks, the excess being
+        // overwritten later. Such a sequence cannot be the last one.
+        if (numLiterals < 15 && matchLength < 15 && iend - ip >= 32 && oend - op >= 64) {
+            memcpy(op, ip, 16);
+            op += numLiterals;
+            ip += numLiterals;
+            size_t const offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+            if (offset == 0 || offset > (size_t)(op - ostart)) return false;
+            matchLength += LZ_MIN_MATCH;
+            if (offset >= 16) {
+                memcpy(op, op - offset, 16);
+                memcpy(op + 16, op - offset + 16, 16);
+            } else {
+                lzCopyMatch(op, offset, matchLength, oend);
+            }
+            op += matchLength;
+            continue;
+        }
+
+        if (numLiterals == 15 && !lzGetLength(ip, iend, numLiterals)) return false;
+        if (numLiterals > (size_t)(iend - ip) || numLiterals > (size_t)(oend - op)) return false;
+        memcpy(op, ip, numLiterals);
+        op += numLiterals;
+        ip += numLiterals;
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return false;
+        size_t const offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - ostart)) return false;
+        if (matchLength == 15 && !lzGetLength(ip, iend, matchLength)) return false;
+        matchLength += LZ_MIN_MATCH;
+        if (matchLength > (size_t)(oend - op)) return false;
+        lzCopyMatch(op, offset, matchLength, oend);
+        op += matchLength;
+    }
+    return op == oend;
+}
+
 //============================================================================
 
 const BrigSectionHeader* getBrigSection(
@@ -224,6 +224,53 @@ size_t     align(size_t s, size_t pow2);
 /// if len < room fills the gap with zeroes. returns min(len,room).
 size_t     zeroPaddedCopy(void *dst, const void* src, size_t len, size_t room);
 
+/// FNV-1a hash of len bytes starting at data.
+size_t     hashBytes(const void* data, size_t len);
+
+/// incremental 64-bit hash of a byte stream (the XXH64 algorithm). It
+/// processes 32 bytes per step and so runs at about memory bandwidth.
+/// The result depends only on the bytes hashed, not on how they are
+/// split between calls to update.
+class ContentHasher {
+public:
+    explicit ContentHasher(uint64_t seed = 0);
+
+    void update(const void* data, size_t len);
+
+    uint64_t digest() const;
+
+private:
+    enum { STRIPE = 32 };
+
+    uint64_t      m_seed;
+    uint64_t      m_acc[4];
+    uint64_t      m_total;
+    unsigned char m_tail[STRIPE]; // bytes not yet making a full stripe
+    unsigned      m_tailSize;
+};
+
+/// @name LZ77 block codec (LZ4-like) used for compressed Brig modules.
+/// Each block is a sequence of literal runs followed by matches of at
+/// least 4 bytes within the preceding 64KB.
+/// @{
+
+/// largest compressed size of len bytes.
+size_t     lzCompressBound(size_t len);
+
+/// largest size len compressed bytes can decompress to.
+uint64_t   lzDecompressBound(uint64_t len);
+
+/// compress len bytes from src into dst, which must have room for
+/// lzCompressBound(len) bytes. Returns the compressed size.
+size_t     lzCompress(const char* src, size_t len, char* dst);
+
+/// decompress len bytes from src into exactly dstLen bytes at dst.
+/// Returns false if the input is malformed or does not decompress
+/// to dstLen bytes; the input is never read and dst never written
+/// beyond their bounds.
+bool       lzDecompress(const char* src, size_t len, char* dst, size_t dstLen);
+/// @}
+
 //============================================================================
 
 const BrigSectionHeader* getBrigSection(
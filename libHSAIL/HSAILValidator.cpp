@@ -1325,23 +1325,34 @@ public:
         return true;
     }
 
-    string getErrorMsg(istream *is) const
+    string getErrorMsg(istream *is, const StreamScannerBase* src = 0) const
     {
         if (err.empty()) return "";
 
         int section = err.getSection();
         unsigned offset = err.getOffset();
-        const SourceInfo* si = getSourceInfo(section, offset);
+        SourceInfo const srcInfo = getSourceInfo(section, offset);
+        const SourceInfo* si = srcInfo.line != -1 ? &srcInfo : NULL;
 
         if (section == -1)
         {
             return err.what();
         }
-        else if (is && si)
+        else if ((is || src) && si)
         {
             ostringstream s;
             SrcLoc const srcLoc = { si->line, si->column };
-            printError(s, *is, srcLoc, err.what());
+            if (src) {
+                std::pair<std::string,unsigned> const context = src->getContextString(srcLoc);
+                if (context.first.empty() && src->isWindowed()) {
+                    // the line has left the scanner window
+                    printErrorPos(s, srcLoc, err.what());
+                } else {
+                    printError(s, context, srcLoc, err.what());
+                }
+            } else {
+                printError(s, *is, srcLoc, err.what());
+            }
             return s.str();
         }
         else
@@ -3138,17 +3149,17 @@ private:
         }
     }
 
-    const SourceInfo* getSourceInfo(int section, unsigned offset) const
+    SourceInfo getSourceInfo(int section, unsigned offset) const
     {
-        if (section == BRIG_SECTION_INDEX_CODE && offset > 0)
+        if (section == BRIG_SECTION_INDEX_CODE)
         {
             return brig.code().sourceInfo(offset);
         }
-        else if (section == BRIG_SECTION_INDEX_OPERAND && offset > 0)
+        else if (section == BRIG_SECTION_INDEX_OPERAND)
         {
             return brig.operands().sourceInfo(offset);
         }
-        return NULL;
+        return SourceInfo();
     }
 
     //-------------------------------------------------------------------------
@@ -3307,6 +3318,7 @@ Validator::~Validator()                                          { delete impl;
 
 bool   Validator::validate(bool disasmOnError /*= false*/) const { return impl->validate(disasmOnError); }
 string Validator::getErrorMsg(istream *is)                 const { return impl->getErrorMsg(is); }
+string Validator::getErrorMsg(const StreamScannerBase& src) const { return impl->getErrorMsg(0, &src); }
 void   Validator::dumpError(ostream* os)                   const { impl->dumpError(os); }
 int    Validator::getErrorCode()                           const { return impl->getErrorCode(); }
 
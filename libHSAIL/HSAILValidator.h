@@ -53,6 +53,8 @@
 using std::istream;
 using std::ostream;
 
+class StreamScannerBase;
+
 namespace HSAIL_ASM {
 
 //============================================================================
@@ -75,6 +77,8 @@ public:
     bool validate(bool disasmOnError = false) const;
 
     std::string getErrorMsg(istream *is) const;
+    /// same, with the context of the error in the text kept by the scanner.
+    std::string getErrorMsg(const StreamScannerBase& src) const;
     void dumpError(ostream* os) const;
     int getErrorCode() const;
 };
@@ -90,6 +90,11 @@ HSAIL_C_API int brig_container_assemble_from_memory(brig_container_t handle, con
     return resultFrom(T(handle)->assembleFromMemory(text, text_length, options));
 }
 
+HSAIL_C_API int brig_container_assemble_from_text(brig_container_t handle, const char* text, const char *options)
+{
+    return resultFrom(T(handle)->assembleFromText(text, options));
+}
+
 HSAIL_C_API int brig_container_assemble_from_file(brig_container_t handle, const char* filename, const char *options)
 {
     return resultFrom(T(handle)->assembleFromFile(filename, options));
@@ -120,6 +125,16 @@ HSAIL_C_API int brig_container_validate(brig_container_t handle)
     return resultFrom(T(handle)->validate());
 }
 
+HSAIL_C_API uint64_t brig_container_get_content_hash(brig_container_t handle)
+{
+    return T(handle)->contentHash();
+}
+
+HSAIL_C_API int brig_container_verify_content_hash(brig_container_t handle)
+{
+    return resultFrom(T(handle)->verifyContentHash());
+}
+
 HSAIL_C_API brig_code_section_offset brig_container_find_code_module_symbol_offset(brig_container_t handle, const char *symbol_name)
 {
   return T(handle)->findCodeModuleSymbolOffset(symbol_name);
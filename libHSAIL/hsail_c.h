@@ -150,12 +150,23 @@ HSAIL_C_API size_t      brig_container_get_section_size(brig_container_t handle,
  *
  * @param handle - BRIG container handle.
  * @param text - pointer to HSAIL text in memory (does not have to be null terminated).
- * @param text_length - length of the HSAIL text in bytes.
+ * @param text_length - length of the HSAIL text in bytes. If the text is null terminated
+ *                      and text_length counts the terminator, the text is not copied.
  *
  * @return zero on success, or a non-zero error code on failure. Use brig_container_get_error_text() to receive further error info.
  */
 HSAIL_C_API int         brig_container_assemble_from_memory(brig_container_t handle, const char* text, size_t text_length, const char *options);
 
+/**
+ * Assemble null terminated HSAIL text in place, without copying it, and store it in a BRIG container.
+ *
+ * @param handle - BRIG container handle.
+ * @param text - pointer to null terminated HSAIL text in memory.
+ *
+ * @return zero on success, or a non-zero error code on failure. Use brig_container_get_error_text() to receive further error info.
+ */
+HSAIL_C_API int         brig_container_assemble_from_text(brig_container_t handle, const char* text, const char *options);
+
 /**
  * Assemble HSAIL text from a file and store it in a BRIG container.
  *
@@ -228,6 +239,28 @@ HSAIL_C_API int         brig_container_validate(brig_container_t handle);
  */
 HSAIL_C_API void* brig_container_get_brig_module(brig_container_t handle);
 
+/**
+ * Obtain the hash of the contents of a BRIG container.
+ *
+ * The hash is recorded in BrigModuleHeader::hash when the container is
+ * saved, and is read from there for modules which have one. Containers
+ * with equal hashes may be assumed to hold the same module.
+ *
+ * @param handle - BRIG container handle.
+ *
+ * @return - 64-bit content hash.
+ */
+HSAIL_C_API uint64_t    brig_container_get_content_hash(brig_container_t handle);
+
+/**
+ * Check that the hash recorded in the loaded BRIG module matches its contents.
+ *
+ * @param handle - BRIG container handle.
+ *
+ * @return zero if the hash matches or the module has no hash, or a non-zero error code otherwise. Use brig_container_get_error_text() to receive further error info.
+ */
+HSAIL_C_API int         brig_container_verify_content_hash(brig_container_t handle);
+
 /**
   *
   */
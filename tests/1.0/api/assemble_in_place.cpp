@@ -0,0 +1,162 @@
+// University of Illinois/NCSA
+// Open Source License
+//
+// Copyright (c) 2013-2015, Advanced Micro Devices, Inc.
+// All rights reserved.
+//
+// Developed by:
+//
+//     HSA Team
+//
+//     Advanced Micro Devices, Inc
+//
+//     www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal with
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimers.
+//
+//     * Redistributions in binary form must reproduce the above copyright notice,
+//       this list of conditions and the following disclaimers in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the names of the LLVM Team, University of Illinois at
+//       Urbana-Champaign, nor the names of its contributors may be used to
+//       endorse or promote products derived from this Software without specific
+//       prior written permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE
+// SOFTWARE.
+
+
+//===----------------------------------------------------------------------===//
+//
+// Checks that assembling from caller memory gives the same result whether
+// the text is scanned in place (its length counts the terminator) or copied
+// (it does not), and that error context is taken from the caller's text.
+//
+//===----------------------------------------------------------------------===//
+
+#include "hsail_c.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char validText[] =
+    "module &module:1:0:$full:$large:$default;\n"
+    "\n"
+    "kernel &Test()\n"
+    "{\n"
+    "\tadd_u32 $s1, $s2, 7;\n"
+    "\tret;\n"
+    "};";
+
+// the bad instruction is on the last line, without a trailing newline
+static const char badLine[] = "\tadd_u32 $s1, $s2, bogus_operand;";
+
+static char* copyWithoutTerminator(const char *text, size_t length)
+{
+    char *copy = (char*)malloc(length);
+    memcpy(copy, text, length);
+    return copy;
+}
+
+static int sameSections(brig_container_t a, brig_container_t b)
+{
+    unsigned i, n = brig_container_get_section_count(a);
+    if (n != brig_container_get_section_count(b)) { return 0; }
+    for (i = 0; i < n; ++i) {
+        size_t size = brig_container_get_section_size(a, (int)i);
+        if (size != brig_container_get_section_size(b, (int)i)) { return 0; }
+        if (memcmp(brig_container_get_section_bytes(a, (int)i),
+                   brig_container_get_section_bytes(b, (int)i), size) != 0) { return 0; }
+    }
+    return 1;
+}
+
+static int checkValid()
+{
+    size_t length = strlen(validText);
+    char *copy = copyWithoutTerminator(validText, length);
+    brig_container_t text = brig_container_create_empty();
+    brig_container_t inPlace = brig_container_create_empty();
+    brig_container_t copied = brig_container_create_empty();
+    int ok = 1;
+
+    if (brig_container_assemble_from_text(text, validText, "") != 0) {
+        fprintf(stderr, "from text: %s\n", brig_container_get_error_text(text));
+        ok = 0;
+    }
+    if (brig_container_assemble_from_memory(inPlace, validText, length + 1, "") != 0) {
+        fprintf(stderr, "with terminator: %s\n", brig_container_get_error_text(inPlace));
+        ok = 0;
+    }
+    if (brig_container_assemble_from_memory(copied, copy, length, "") != 0) {
+        fprintf(stderr, "without terminator: %s\n", brig_container_get_error_text(copied));
+        ok = 0;
+    }
+    if (ok && !(sameSections(text, inPlace) && sameSections(text, copied))) {
+        fprintf(stderr, "modules assembled from the same text differ\n");
+        ok = 0;
+    }
+    brig_container_destroy(text);
+    brig_container_destroy(inPlace);
+    brig_container_destroy(copied);
+    free(copy);
+    return ok;
+}
+
+static int checkError(const char *what, const char *text, size_t length)
+{
+    brig_container_t c = brig_container_create_empty();
+    int ok = 1;
+    if (brig_container_assemble_from_memory(c, text, length, "") == 0) {
+        fprintf(stderr, "%s: bad text assembled\n", what);
+        ok = 0;
+    } else if (strstr(brig_container_get_error_text(c), badLine + 1) == NULL) {
+        fprintf(stderr, "%s: no source line in error:\n%s\n", what, brig_container_get_error_text(c));
+        ok = 0;
+    }
+    brig_container_destroy(c);
+    return ok;
+}
+
+static int checkErrors()
+{
+    const char *end = strstr(validText, "\tret;");
+    size_t prefix = (size_t)(end - validText);
+    size_t length = prefix + strlen(badLine);
+    char *text = (char*)malloc(length + 1);
+    char *copy;
+    int ok;
+
+    memcpy(text, validText, prefix);
+    memcpy(text + prefix, badLine, strlen(badLine) + 1);
+    copy = copyWithoutTerminator(text, length);
+
+    ok = checkError("with terminator", text, length + 1);
+    ok = checkError("without terminator", copy, length) && ok;
+
+    free(text);
+    free(copy);
+    return ok;
+}
+
+int main()
+{
+    int ok = checkValid();
+    ok = checkErrors() && ok;
+    return ok ? 0 : 1;
+}
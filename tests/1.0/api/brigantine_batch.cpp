@@ -0,0 +1,127 @@
+// University of Illinois/NCSA
+// Open Source License
+//
+// Copyright (c) 2013-2015, Advanced Micro Devices, Inc.
+// All rights reserved.
+//
+// Developed by:
+//
+//     HSA Team
+//
+//     Advanced Micro Devices, Inc
+//
+//     www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal with
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimers.
+//
+//     * Redistributions in binary form must reproduce the above copyright notice,
+//       this list of conditions and the following disclaimers in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the names of the LLVM Team, University of Illinois at
+//       Urbana-Champaign, nor the names of its contributors may be used to
+//       endorse or promote products derived from this Software without specific
+//       prior written permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE
+// SOFTWARE.
+
+
+//===----------------------------------------------------------------------===//
+//
+// Checks that instructions emitted within a Brigantine batch produce the
+// same Brig module as those emitted one by one.
+//
+//===----------------------------------------------------------------------===//
+
+#include "HSAILBrigantine.h"
+#include "HSAILBrigContainer.h"
+#include "HSAILBrigObjectFile.h"
+#include "HSAILItems.h"
+#include "HSAILValidator.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace HSAIL_ASM;
+
+static const unsigned NUM_INSTS = 1000;
+
+enum BatchMode {
+    NO_BATCH,
+    BATCH,          // room is reserved for all instructions and operands
+    SMALL_BATCH     // reserved room is exceeded, the rest is appended as usual
+};
+
+static bool emit(BatchMode mode, std::vector<char>& module) {
+    BrigContainer c;
+    Brigantine bw(c);
+    bw.startProgram();
+    bw.module("&batch", BRIG_VERSION_HSAIL_MAJOR, BRIG_VERSION_HSAIL_MINOR,
+              BRIG_MACHINE_LARGE, BRIG_PROFILE_FULL, BRIG_ROUND_FLOAT_DEFAULT);
+    DirectiveKernel kernel = bw.declKernel("&kernel");
+    kernel.linkage() = BRIG_LINKAGE_PROGRAM;
+    kernel.modifier().isDefinition() = true;
+    kernel.firstInArg() = c.code().end();
+    bw.startBody();
+
+    size_t const codeBytes = NUM_INSTS * sizeof(BrigInstBasic);
+    size_t const operandBytes = NUM_INSTS * (2 * sizeof(BrigOperandRegister) + sizeof(BrigOperandConstantBytes));
+    if (mode == BATCH) {
+        bw.beginBatch(codeBytes, operandBytes);
+    } else if (mode == SMALL_BATCH) {
+        bw.beginBatch(codeBytes / 4, operandBytes / 4);
+    }
+    for(unsigned i = 0; i < NUM_INSTS; ++i) {
+        InstBasic const inst = bw.addInst<InstBasic>(BRIG_OPCODE_ADD, BRIG_TYPE_U32);
+        Operand const operands[] = {
+            bw.createOperandReg("$s1"),
+            bw.createOperandReg("$s2"),
+            bw.createImmed((int64_t)i, BRIG_TYPE_U32)
+        };
+        bw.setOperands(inst, operands, sizeof operands / sizeof operands[0]);
+    }
+    bw.setOperands(bw.addInst<InstBasic>(BRIG_OPCODE_RET, BRIG_TYPE_NONE), ItemList());
+    if (mode != NO_BATCH) {
+        bw.endBatch();
+    }
+
+    bw.endBody();
+    bw.endProgram();
+
+    Validator vld(c);
+    if (!vld.validate()) {
+        std::cerr << vld.getErrorMsg(0) << std::endl;
+        return false;
+    }
+    return 0 == BrigIO::save(c, FILE_FORMAT_BRIG, *BrigIO::vectorWritingAdapter(module, std::cerr));
+}
+
+int main() {
+    std::vector<char> expected, batched, smallBatched;
+    if (!emit(NO_BATCH, expected) || !emit(BATCH, batched) || !emit(SMALL_BATCH, smallBatched)) {
+        return 1;
+    }
+    if (batched != expected) {
+        std::cerr << "batched module differs from unbatched one" << std::endl;
+        return 1;
+    }
+    if (smallBatched != expected) {
+        std::cerr << "module of overflowing batch differs from unbatched one" << std::endl;
+        return 1;
+    }
+    return 0;
+}
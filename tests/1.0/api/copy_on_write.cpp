@@ -0,0 +1,201 @@
+// University of Illinois/NCSA
+// Open Source License
+//
+// Copyright (c) 2013-2015, Advanced Micro Devices, Inc.
+// All rights reserved.
+//
+// Developed by:
+//
+//     HSA Team
+//
+//     Advanced Micro Devices, Inc
+//
+//     www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal with
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimers.
+//
+//     * Redistributions in binary form must reproduce the above copyright notice,
+//       this list of conditions and the following disclaimers in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the names of the LLVM Team, University of Illinois at
+//       Urbana-Champaign, nor the names of its contributors may be used to
+//       endorse or promote products derived from this Software without specific
+//       prior written permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE
+// SOFTWARE.
+
+
+
+//===----------------------------------------------------------------------===//
+//
+// Checks that containers loaded copy-on-write copy only the sections which
+// are modified, by patchDecl2Defs or through item proxies, and leave the
+// loaded module intact.
+//
+//===----------------------------------------------------------------------===//
+
+#include "HSAILBrigContainer.h"
+#include "HSAILBrigObjectFile.h"
+#include "HSAILItems.h"
+#include "HSAILTool.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+using namespace HSAIL_ASM;
+
+static const char text[] =
+    "module &cow:1:0:$full:$large:$default;\n"
+    "\n"
+    "decl function &callee()();\n"
+    "\n"
+    "function &caller()()\n"
+    "{\n"
+    "\t{\n"
+    "\t\tcall &callee () ();\n"
+    "\t}\n"
+    "};\n"
+    "\n"
+    "function &callee()()\n"
+    "{\n"
+    "\tret;\n"
+    "};\n";
+
+static const char* const moduleFile = "copy_on_write.brig";
+
+static bool save(BrigContainer& c, std::vector<char>& module) {
+    module.clear();
+    return 0 == BrigIO::save(c, FILE_FORMAT_BRIG, *BrigIO::vectorWritingAdapter(module, std::cerr));
+}
+
+static bool readFile(const char* name, std::vector<char>& bytes) {
+    std::ifstream ifs(name, std::ifstream::binary);
+    bytes.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    return !ifs.bad() && !bytes.empty();
+}
+
+/// check which sections of c own their data.
+static bool checkCopied(BrigContainer& c, const char* what,
+                        bool data, bool code, bool operands) {
+    bool const copied[] = { data, code, operands };
+    bool ok = true;
+    for(int i = 0; i < BRIG_SECTION_INDEX_IMPLEMENTATION_DEFINED; ++i) {
+        if ((c.sectionById(i).capacity() != 0) != copied[i]) {
+            std::cerr << what << ": section " << c.sectionById(i).name()
+                      << (copied[i] ? " is not copied" : " is copied") << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static DirectiveFunction findFunction(BrigContainer& c, bool definition) {
+    for(Code d = c.code().begin(), e = c.code().end(); d != e; d = d.next()) {
+        DirectiveFunction f = d;
+        if (f && f.name().str() == "&callee" && f.modifier().isDefinition() == definition) {
+            return f;
+        }
+    }
+    return DirectiveFunction();
+}
+
+static OperandCodeRef findCallTarget(BrigContainer& c) {
+    for(Code d = c.code().begin(), e = c.code().end(); d != e; d = d.next()) {
+        InstBr call = d;
+        if (call && call.opcode() == BRIG_OPCODE_CALL) {
+            return call.operand(1);
+        }
+    }
+    return OperandCodeRef();
+}
+
+int main() {
+    // the assembler links calls to definitions
+    Tool t;
+    std::vector<char> linked;
+    if (!t.assembleFromText(text) || !save(*t.container(), linked)) {
+        std::cerr << t.output();
+        return 1;
+    }
+
+    // a module calling the declaration is made through proxies of a
+    // writable container
+    BrigContainer w;
+    if (BrigIO::load(w, FILE_FORMAT_BRIG, BrigIO::memoryReadingAdapter(&linked[0], linked.size()), LOAD_WRITABLE)) {
+        return 1;
+    }
+    OperandCodeRef target = findCallTarget(w);
+    DirectiveFunction decl = findFunction(w, false);
+    if (!target || !decl || target.ref() == decl) {
+        std::cerr << "call of the definition is not found" << std::endl;
+        return 1;
+    }
+    target.ref() = decl;
+    std::vector<char> unlinked;
+    if (!save(w, unlinked)) return 1;
+    {
+        std::ofstream ofs(moduleFile, std::ofstream::binary);
+        ofs.write(&unlinked[0], unlinked.size());
+        if (!ofs) return 1;
+    }
+
+    bool ok = true;
+
+    // patchDecl2Defs on a copy-on-write container copies the operand
+    // section only and links the call again
+    {
+        BrigContainer c;
+        if (BrigIO::load(c, FILE_FORMAT_BRIG, BrigIO::mappedFileReadingAdapter(moduleFile), LOAD_COPY_ON_WRITE)) {
+            return 1;
+        }
+        ok &= checkCopied(c, "loaded", false, false, false);
+        c.patchDecl2Defs();
+        ok &= checkCopied(c, "patchDecl2Defs", false, false, true);
+        std::vector<char> patched;
+        if (!save(c, patched)) return 1;
+        if (patched != linked) {
+            std::cerr << "patchDecl2Defs result differs from assembled module" << std::endl;
+            ok = false;
+        }
+    }
+
+    // writes through proxies copy the section written; the mapping is
+    // read-only, so a write reaching it would fault
+    {
+        BrigContainer c;
+        if (BrigIO::load(c, FILE_FORMAT_BRIG, BrigIO::mappedFileReadingAdapter(moduleFile), LOAD_COPY_ON_WRITE)) {
+            return 1;
+        }
+        DirectiveFunction f = findFunction(c, true);
+        f.linkage() = BRIG_LINKAGE_PROGRAM;
+        f.name() = "&renamed";
+        ok &= checkCopied(c, "proxy writes", true, true, false);
+        if (findFunction(c, true) || f.linkage() != BRIG_LINKAGE_PROGRAM) {
+            std::cerr << "proxy writes are lost" << std::endl;
+            ok = false;
+        }
+        std::vector<char> onDisk;
+        if (!readFile(moduleFile, onDisk) || onDisk != unlinked) {
+            std::cerr << "proxy writes reached the loaded module" << std::endl;
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+// University of Illinois/NCSA
+// Open Source License
+//
+// Copyright (c) 2013-2015, Advanced Micro Devices, Inc.
+// All rights reserved.
+//
+// Developed by:
+//
+//     HSA Team
+//
+//     Advanced Micro Devices, Inc
+//
+//     www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal with
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimers.
+//
+//     * Redistributions in binary form must reproduce the above copyright notice,
+//       this list of conditions and the following disclaimers in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the names of the LLVM Team, University of Illinois at
+//       Urbana-Champaign, nor the names of its contributors may be used to
+//       endorse or promote products derived from this Software without specific
+//       prior written permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE
+// SOFTWARE.
+
+
+
+//===----------------------------------------------------------------------===//
+//
+// Checks that lazily loaded containers can be read from several threads at
+// once, and that mapped modules are used in place by BrigIO::loadLazily.
+//
+//===----------------------------------------------------------------------===//
+
+#include "HSAILBrigContainer.h"
+#include "HSAILBrigObjectFile.h"
+#include "HSAILTool.h"
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace HSAIL_ASM;
+
+static const char text[] =
+    "module &lazy:1:0:$full:$large:$default;\n"
+    "\n"
+    "prog kernel &k(kernarg_u64 %out)\n"
+    "{\n"
+    "\tld_kernarg_u64 $d0, [%out];\n"
+    "\tst_global_u32 123, [$d0];\n"
+    "\tret;\n"
+    "};\n";
+
+static const char* const moduleFile = "lazy_load.brig";
+static const unsigned NUM_THREADS = 8;
+
+static std::string sectionBytes(const BrigContainer& c, int index) {
+    const BrigSectionImpl& s = c.sectionById(index);
+    return std::string(s.getData(0), s.size());
+}
+
+int main() {
+    Tool t;
+    if (!t.assembleFromText(text) ||
+        0 != BrigIO::save(*t.container(), FILE_FORMAT_BRIG, *BrigIO::fileWritingAdapter(moduleFile))) {
+        std::cerr << t.output();
+        return 1;
+    }
+    BrigContainer& expected = *t.container();
+    int const numSections = expected.getNumSections();
+
+    // section names are known without loading the sections
+    BrigContainer lazy;
+    if (0 != BrigIO::loadLazily(lazy, FILE_FORMAT_BRIG, std::shared_ptr<ReadAdapter>(BrigIO::fileReadingAdapter(moduleFile).release()))) {
+        return 1;
+    }
+    for(int i = 0; i < numSections; ++i) {
+        if (lazy.brigSectionIdByName(expected.sectionById(i).name()) != i) {
+            std::cerr << "section " << expected.sectionById(i).name() << " not found by name" << std::endl;
+            return 1;
+        }
+    }
+
+    // every thread loads or waits for each section on first access
+    const BrigContainer& shared = lazy;
+    std::vector<int> mismatches(NUM_THREADS);
+    std::vector<std::thread> readers;
+    for(unsigned n = 0; n < NUM_THREADS; ++n) {
+        readers.push_back(std::thread([&, n]() {
+            for(int k = 0; k < numSections; ++k) {
+                int const i = (int)((k + n) % numSections);
+                if (sectionBytes(shared, i) != sectionBytes(expected, i)) ++mismatches[n];
+            }
+        }));
+    }
+    for(unsigned n = 0; n < NUM_THREADS; ++n) {
+        readers[n].join();
+        if (mismatches[n]) {
+            std::cerr << "thread " << n << " read wrong section contents" << std::endl;
+            return 1;
+        }
+    }
+    if (lazy.lazyLoadFailed()) {
+        return 1;
+    }
+
+    // mapped modules are used in place until modified
+    BrigContainer mapped;
+    if (0 != BrigIO::loadLazily(mapped, FILE_FORMAT_BRIG, std::shared_ptr<ReadAdapter>(BrigIO::mappedFileReadingAdapter(moduleFile).release()))) {
+        return 1;
+    }
+    for(int i = 0; i < numSections; ++i) {
+        if (mapped.sectionById(i).capacity() != 0 || sectionBytes(mapped, i) != sectionBytes(expected, i)) {
+            std::cerr << "mapped section " << expected.sectionById(i).name() << " is copied or differs" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,191 @@
+// University of Illinois/NCSA
+// Open Source License
+//
+// Copyright (c) 2013-2015, Advanced Micro Devices, Inc.
+// All rights reserved.
+//
+// Developed by:
+//
+//     HSA Team
+//
+//     Advanced Micro Devices, Inc
+//
+//     www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal with
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimers.
+//
+//     * Redistributions in binary form must reproduce the above copyright notice,
+//       this list of conditions and the following disclaimers in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the names of the LLVM Team, University of Illinois at
+//       Urbana-Champaign, nor the names of its contributors may be used to
+//       endorse or promote products derived from this Software without specific
+//       prior written permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE
+// SOFTWARE.
+
+
+
+//===----------------------------------------------------------------------===//
+//
+// Checks that the scalar, SSE2 and AVX2 bulk scans of the scanner agree,
+// both called directly around vector boundaries and when assembling text
+// with CRLF line ends, comments and embedded text. Implementations not
+// supported by the build or the CPU are skipped.
+//
+//===----------------------------------------------------------------------===//
+
+#include "HSAILScanner.h"
+#include "HSAILBrigContainer.h"
+#include "HSAILBrigObjectFile.h"
+#include "HSAILTool.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace HSAIL_ASM;
+
+/// gives access to the bulk scans.
+struct BulkScans : StreamScannerBase {
+    using StreamScannerBase::skipBlanks;
+    using StreamScannerBase::findLineEnd;
+    using StreamScannerBase::findCommentStop;
+    using StreamScannerBase::findEmbeddedTextStop;
+};
+
+typedef const char* (*ScanFunc)(const char* p, const char* end);
+
+static const ScanFunc scans[] = {
+    &BulkScans::skipBlanks,
+    &BulkScans::findLineEnd,
+    &BulkScans::findCommentStop,
+    &BulkScans::findEmbeddedTextStop
+};
+
+// characters the scans stop at or skip, and ones they pass by
+static const char special[] = " \t\n\r*#";
+static const char ordinary[] = "a/<>";
+
+/// offsets of the results of all scans for texts of up to 80 characters
+/// with a stop character at each position, starting at several alignments.
+static std::vector<int> scanResults() {
+    std::vector<int> res;
+    std::vector<char> text(96);
+    for(int len = 0; len <= 80; ++len) {
+        for(int pos = 0; pos <= len; ++pos) {
+            for(size_t s = 0; s < sizeof special; ++s) { // including '\0'
+                for(size_t fill = 0; fill < 4; ++fill) {
+                    // blank fill for skipBlanks, other fill for the finds
+                    char const filler = fill < 2 ? " \t"[fill] : ordinary[fill - 2];
+                    for(int start = 0; start < 4 && start <= len; ++start) {
+                        text.assign(text.size(), filler);
+                        if (pos < len) text[pos] = special[s];
+                        for(size_t f = 0; f < sizeof scans / sizeof scans[0]; ++f) {
+                            res.push_back((int)(scans[f](&text[start], &text[len]) - &text[0]));
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return res;
+}
+
+/// HSAIL text whose comments and embedded text cross 16 and 32 byte
+/// boundaries at various points depending on pad.
+static std::string source(int pad, const char* nl) {
+    std::string const spaces(pad, ' ');
+    std::string const stars(pad, '*');
+    std::ostringstream s;
+    s << "module &scan:1:0:$full:$large:$default;" << nl
+      << spaces << "// line comment " << spaces << "with * and # inside" << nl
+      << "/*" << stars << " block comment" << nl
+      << spaces << "over two lines with # and " << stars << "*/" << nl
+      << "prog kernel &k()" << nl
+      << "{" << nl
+      << "<#" << spaces << " embedded text with * and " << nl << " a line break #" << spaces << "#>" << nl
+      << "\t" << spaces << "add_u32\t$s1, $s2, 3; // after code" << spaces << nl
+      << spaces << "\t/* within */ ret;" << nl
+      << "};" << nl;
+    return s.str();
+}
+
+/// assembles each source with comments kept, collecting Brig and messages.
+static std::vector<std::string> assembled() {
+    std::vector<std::string> res;
+    const char* const lineEnds[] = { "\n", "\r\n" };
+    for(int nl = 0; nl < 2; ++nl) {
+        for(int pad = 0; pad <= 40; ++pad) {
+            std::string const text = source(pad, lineEnds[nl]);
+            Tool t;
+            std::vector<char> brig;
+            if (t.assembleFromText(text.c_str(), "-enable-comments") &&
+                0 == BrigIO::save(*t.container(), FILE_FORMAT_BRIG, *BrigIO::vectorWritingAdapter(brig, std::cerr))) {
+                res.push_back(std::string(brig.begin(), brig.end()));
+            } else {
+                res.push_back("failed: " + t.output());
+            }
+            // an unterminated comment is reported at its end
+            Tool u;
+            std::string const cut = text.substr(0, text.find("*/"));
+            u.assembleFromText(cut.c_str(), "-enable-comments");
+            res.push_back(u.output());
+        }
+    }
+    return res;
+}
+
+int main() {
+    if (!StreamScannerBase::selectScanImpl(StreamScannerBase::SCAN_SCALAR)) {
+        std::cerr << "scalar scans are not available" << std::endl;
+        return 1;
+    }
+    std::vector<int> const expectedScans = scanResults();
+    std::vector<std::string> const expectedBrig = assembled();
+    for(size_t i = 0; i < expectedBrig.size(); i += 2) {
+        if (expectedBrig[i].compare(0, 8, "failed: ") == 0 ||
+            expectedBrig[i + 1].find("Premature end of comment") == std::string::npos) {
+            std::cerr << "unexpected scalar results:" << std::endl
+                      << expectedBrig[i] << std::endl << expectedBrig[i + 1] << std::endl;
+            return 1;
+        }
+    }
+
+    struct { StreamScannerBase::ScanImpl impl; const char* name; } const impls[] = {
+        { StreamScannerBase::SCAN_SSE2, "SSE2" },
+        { StreamScannerBase::SCAN_AVX2, "AVX2" }
+    };
+    bool ok = true;
+    for(size_t i = 0; i < sizeof impls / sizeof impls[0]; ++i) {
+        if (!StreamScannerBase::selectScanImpl(impls[i].impl)) {
+            std::cout << impls[i].name << " scans are not available, skipped" << std::endl;
+            continue;
+        }
+        if (scanResults() != expectedScans) {
+            std::cerr << impls[i].name << " scans differ from scalar ones" << std::endl;
+            ok = false;
+        }
+        if (assembled() != expectedBrig) {
+            std::cerr << "assembling with " << impls[i].name << " scans differs from scalar ones" << std::endl;
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+// University of Illinois/NCSA
+// Open Source License
+//
+// Copyright (c) 2013-2015, Advanced Micro Devices, Inc.
+// All rights reserved.
+//
+// Developed by:
+//
+//     HSA Team
+//
+//     Advanced Micro Devices, Inc
+//
+//     www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal with
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimers.
+//
+//     * Redistributions in binary form must reproduce the above copyright notice,
+//       this list of conditions and the following disclaimers in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the names of the LLVM Team, University of Illinois at
+//       Urbana-Champaign, nor the names of its contributors may be used to
+//       endorse or promote products derived from this Software without specific
+//       prior written permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE
+// SOFTWARE.
+
+
+
+//===----------------------------------------------------------------------===//
+//
+// Checks source positions recorded for code and operands on assembly, and
+// that items without one report line -1.
+//
+//===----------------------------------------------------------------------===//
+
+#include "HSAILBrigContainer.h"
+#include "HSAILItems.h"
+#include "HSAILTool.h"
+
+#include <iostream>
+
+using namespace HSAIL_ASM;
+
+static const char text[] =
+    "module &srcinfo:1:0:$full:$large:$default;\n"
+    "\n"
+    "prog kernel &k()\n"
+    "{\n"
+    "    add_u32 $s1, $s2, 3;\n"
+    "  mov_b32   $s0, $s1;\n"
+    "    ret;\n"
+    "};\n";
+
+static bool check(const char* what, const SourceInfo& si, int line, int column) {
+    if (si.line != line || si.column != column) {
+        std::cerr << what << " is at " << si.line << ":" << si.column
+                  << ", expected " << line << ":" << column << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool run(const char* opts, bool operandSrcInfo) {
+    Tool t;
+    if (!t.assembleFromText(text, opts)) {
+        std::cerr << t.output();
+        return false;
+    }
+    BrigContainer& c = *t.container();
+
+    Inst insts[3];
+    unsigned n = 0;
+    bool ok = true;
+    for(Code d = c.code().begin(), e = c.code().end(); d != e; d = d.next()) {
+        if (DirectiveKernel k = d) {
+            // the position of a kernel is that of its name
+            ok = check("kernel", c.sourceInfo(k), 2, 12) && ok;
+        } else if (Inst i = d) {
+            if (n < 3) insts[n] = i;
+            ++n;
+        }
+    }
+    if (n != 3) {
+        std::cerr << "expected 3 instructions, found " << n << std::endl;
+        return false;
+    }
+
+    // lines and columns are 0-based
+    ok = check("add", insts[0].srcInfo(), 4, 4) && ok;
+    ok = check("mov", c.code().sourceInfo(insts[1]), 5, 2) && ok;
+    ok = check("ret", c.sourceInfo(insts[2]), 6, 4) && ok;
+
+    Operand const mov0 = insts[1].operand(0);
+    Operand const mov1 = insts[1].operand(1);
+    if (operandSrcInfo) {
+        // equal operands may be shared, so only the first uses are checked
+        ok = check("$s0", mov0.srcInfo(), 5, 12) && ok;
+        ok = check("3", insts[0].operand(2).srcInfo(), 4, 22) && ok;
+    } else {
+        ok = check("$s0", mov0.srcInfo(), -1, -1) && ok;
+        ok = check("$s1", mov1.srcInfo(), -1, -1) && ok;
+    }
+
+    // items added without source info have none
+    Inst const added = c.append<InstBasic>();
+    ok = check("appended instruction", added.srcInfo(), -1, -1) && ok;
+    ok = check("offset 0", c.code().sourceInfo(Offset(0)), -1, -1) && ok;
+    return ok;
+}
+
+int main() {
+    bool ok = run("", true);
+    ok = run("-disable-operand-srcinfo", false) && ok;
+    return ok ? 0 : 1;
+}
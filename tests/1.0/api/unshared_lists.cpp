@@ -0,0 +1,92 @@
+// University of Illinois/NCSA
+// Open Source License
+//
+// Copyright (c) 2013-2015, Advanced Micro Devices, Inc.
+// All rights reserved.
+//
+// Developed by:
+//
+//     HSA Team
+//
+//     Advanced Micro Devices, Inc
+//
+//     www.amd.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal with
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimers.
+//
+//     * Redistributions in binary form must reproduce the above copyright notice,
+//       this list of conditions and the following disclaimers in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the names of the LLVM Team, University of Illinois at
+//       Urbana-Champaign, nor the names of its contributors may be used to
+//       endorse or promote products derived from this Software without specific
+//       prior written permission.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE
+// SOFTWARE.
+
+
+
+//===----------------------------------------------------------------------===//
+//
+// Checks that lists added with ListRef::assignUnshared are never handed out
+// for equal contents by later shared list assignments.
+//
+//===----------------------------------------------------------------------===//
+
+#include "HSAILBrigContainer.h"
+#include "HSAILItems.h"
+
+#include <iostream>
+
+using namespace HSAIL_ASM;
+
+int main() {
+    BrigContainer c;
+    Code const target = c.append<DirectiveLabel>();
+
+    ItemList placeholders;
+    placeholders.push_back(Code());
+    placeholders.push_back(Code());
+
+    // the unshared list is the first one in the data section, so the
+    // deduplication index is built after it has been added
+    OperandCodeList patched = c.append<OperandCodeList>();
+    patched.elements().assignUnshared(placeholders);
+    OperandCodeList shared = c.append<OperandCodeList>();
+    shared.elements() = placeholders;
+
+    if (patched.elements().deref() == shared.elements().deref()) {
+        std::cerr << "shared list reuses an unshared one" << std::endl;
+        return 1;
+    }
+
+    patched.elements().writeAccess(0) = target;
+    if (shared.elements()[0] || shared.elements()[1]) {
+        std::cerr << "update of an unshared list changed a shared one" << std::endl;
+        return 1;
+    }
+
+    // equal shared lists still share storage
+    OperandCodeList other = c.append<OperandCodeList>();
+    other.elements() = placeholders;
+    if (other.elements().deref() != shared.elements().deref()) {
+        std::cerr << "equal shared lists are not deduplicated" << std::endl;
+        return 1;
+    }
+    return 0;
+}